@@ -0,0 +1,23 @@
+#version 330 core
+layout (location = 0) in vec4 vertex; // <vec2 position, vec2 texCoords>
+// one value per particle, read straight from the arrays of ParticleSystem
+layout (location = 1) in float positionX;
+layout (location = 2) in float positionY;
+layout (location = 3) in float size;
+layout (location = 4) in float alpha;
+layout (location = 5) in vec4 color; // RGBA8, the alpha byte is unused
+
+out vec2 texCoords;
+out vec4 particleColor;
+
+// set once per frame by Camera2D
+layout (std140) uniform Camera {
+	mat4 viewProjection;
+};
+
+void main() {
+	vec2 world = (vertex.xy - 0.5) * size + vec2(positionX, positionY);
+	texCoords = vertex.zw;
+	particleColor = vec4(color.rgb, alpha);
+	gl_Position = viewProjection * vec4(world, 0.0, 1.0);
+}
\ No newline at end of file
@@ -1,11 +1,19 @@
 #version 330 core
-layout (location = 0) in vec4 vertex; // <vec2 pos, vec2 tex>
+layout (location = 0) in vec2 corner; // corner of the unit quad
+layout (location = 1) in vec4 glyphRect; // <vec2 top-left, vec2 size> in world units
+layout (location = 2) in vec4 glyphUV; // <vec2 offset, vec2 scale> of the glyph in the atlas
+layout (location = 3) in vec4 glyphColor; // RGBA8
 out vec2 TexCoords;
+out vec4 TextColor;
 
-uniform mat4 projection;
+// set once per frame by Camera2D
+layout (std140) uniform Camera {
+    mat4 viewProjection;
+};
 
 void main()
 {
-    gl_Position = projection * vec4(vertex.xy, 0.0, 1.0);
-    TexCoords = vertex.zw;
-} 
\ No newline at end of file
+    gl_Position = viewProjection * vec4(glyphRect.xy + corner * glyphRect.zw, 0.0, 1.0);
+    TexCoords = glyphUV.xy + corner * glyphUV.zw;
+    TextColor = glyphColor;
+}
\ No newline at end of file
@@ -4,9 +4,12 @@ layout (location = 0) in vec4 vertex; // <vec2 position, vec2 texCoords>
 out vec2 texCoords;
 
 uniform mat4 model;
-uniform mat4 projection;
+// set once per frame by Camera2D
+layout (std140) uniform Camera {
+	mat4 viewProjection;
+};
 
 void main() {
 	texCoords = vertex.zw;
-	gl_Position = projection * model * vec4(vertex.x, vertex.y, 0.0, 1.0);
+	gl_Position = viewProjection * model * vec4(vertex.x, vertex.y, 0.0, 1.0);
 }
\ No newline at end of file
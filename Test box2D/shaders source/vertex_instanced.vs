@@ -0,0 +1,25 @@
+#version 330 core
+layout (location = 0) in vec4 vertex; // <vec2 position, vec2 texCoords>
+layout (location = 1) in vec4 instanceTransform; // <vec2 center, vec2 size>
+layout (location = 2) in vec4 instanceColor; // <vec3 color, float rotation>
+layout (location = 3) in vec4 instanceUV; // <vec2 offset, vec2 scale> of the texture region
+
+out vec2 texCoords;
+out vec3 spriteColor;
+
+// set once per frame by Camera2D
+layout (std140) uniform Camera {
+	mat4 viewProjection;
+};
+
+void main() {
+	// the unit quad is centered, scaled and then rotated around the sprite center
+	vec2 local = (vertex.xy - 0.5) * instanceTransform.zw;
+	float c = cos(instanceColor.w);
+	float s = sin(instanceColor.w);
+	vec2 world = vec2(c * local.x - s * local.y, s * local.x + c * local.y) + instanceTransform.xy;
+
+	texCoords = instanceUV.xy + vertex.zw * instanceUV.zw;
+	spriteColor = instanceColor.rgb;
+	gl_Position = viewProjection * vec4(world, 0.0, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,128 @@
+#include "batch_query.h"
+
+void RayCastBatch::clear()
+{
+	origins.clear();
+	ends.clear();
+	handles.clear();
+	points.clear();
+	normals.clear();
+	fractions.clear();
+}
+
+void RayCastBatch::resetResults()
+{
+	handles.assign(size(), INVALID_BODY_HANDLE);
+	points.resize(size());
+	normals.resize(size());
+	fractions.assign(size(), 1.0f);
+}
+
+void BoxQueryBatch::clear()
+{
+	boxes.clear();
+	offsets.clear();
+	hits.clear();
+}
+
+void BoxQueryBatch::resetResults(unsigned int chunk_count)
+{
+	if (chunk_hits.size() < chunk_count)
+		chunk_hits.resize(chunk_count);
+	for (std::vector<BodyHandle>& chunk : chunk_hits)
+		chunk.clear();
+	counts.assign(size(), 0);
+}
+
+void BoxQueryBatch::mergeChunks()
+{
+	offsets.resize(size() + 1);
+	offsets[0] = 0;
+	for (unsigned int i = 0; i < size(); i++)
+		offsets[i + 1] = offsets[i] + counts[i];
+	// the chunks hold consecutive boxes, so their concatenation is in box order
+	hits.clear();
+	for (const std::vector<BodyHandle>& chunk : chunk_hits)
+		hits.insert(hits.end(), chunk.begin(), chunk.end());
+}
+
+namespace
+{
+	// called by b2DynamicTree::RayCast for each proxy crossed by the ray. Returning the
+	// fraction of a hit clips the ray, so only closer proxies are reported afterwards
+	class ClosestHitCallback {
+	public:
+		explicit ClosestHitCallback(const b2BroadPhase& broad_phase) : handle(INVALID_BODY_HANDLE), fraction(1.0f), m_broad_phase(broad_phase) {}
+		BodyHandle handle;
+		b2Vec2 normal;
+		float fraction;
+		float RayCastCallback(const b2RayCastInput& input, int32 proxy_id)
+		{
+			const b2FixtureProxy* proxy = static_cast<const b2FixtureProxy*>(m_broad_phase.GetUserData(proxy_id));
+			if (proxy->fixture->IsSensor())
+				return -1.0f;
+			b2RayCastOutput output;
+			if (!proxy->fixture->RayCast(&output, input, proxy->childIndex))
+				return input.maxFraction;
+			handle = static_cast<BodyHandle>(proxy->fixture->GetBody()->GetUserData().pointer);
+			normal = output.normal;
+			fraction = output.fraction;
+			return output.fraction;
+		}
+	private:
+		const b2BroadPhase& m_broad_phase;
+	};
+
+	// called by b2DynamicTree::Query for each proxy whose fat box overlaps the query box
+	class OverlapCallback {
+	public:
+		OverlapCallback(const b2BroadPhase& broad_phase, const b2AABB& box, std::vector<BodyHandle>& hits) : m_broad_phase(broad_phase), m_box(box), m_hits(hits) {}
+		bool QueryCallback(int32 proxy_id)
+		{
+			const b2FixtureProxy* proxy = static_cast<const b2FixtureProxy*>(m_broad_phase.GetUserData(proxy_id));
+			const b2Fixture* fixture = proxy->fixture;
+			if (fixture->IsSensor())
+				return true;
+			// the broadphase boxes are fattened, test the actual box of the fixture
+			b2AABB fixture_box;
+			fixture->GetShape()->ComputeAABB(&fixture_box, fixture->GetBody()->GetTransform(), proxy->childIndex);
+			if (b2TestOverlap(fixture_box, m_box))
+				m_hits.push_back(static_cast<BodyHandle>(fixture->GetBody()->GetUserData().pointer));
+			return true;
+		}
+	private:
+		const b2BroadPhase& m_broad_phase;
+		const b2AABB& m_box;
+		std::vector<BodyHandle>& m_hits;
+	};
+}
+
+void castRays(const b2World& world, RayCastBatch& batch, unsigned int begin, unsigned int end)
+{
+	const b2BroadPhase& broad_phase = world.GetContactManager().m_broadPhase;
+	for (unsigned int i = begin; i < end; i++)
+	{
+		b2RayCastInput input;
+		input.p1 = batch.origins[i];
+		input.p2 = batch.ends[i];
+		// a hit found in another world limits the ray
+		input.maxFraction = batch.fractions[i];
+		if (input.p1 == input.p2 || input.maxFraction <= 0.0f)
+			continue;
+		ClosestHitCallback callback(broad_phase);
+		broad_phase.RayCast(&callback, input);
+		if (callback.handle == INVALID_BODY_HANDLE)
+			continue;
+		batch.handles[i] = callback.handle;
+		batch.points[i] = input.p1 + callback.fraction * (input.p2 - input.p1);
+		batch.normals[i] = callback.normal;
+		batch.fractions[i] = callback.fraction;
+	}
+}
+
+void queryBox(const b2World& world, const b2AABB& box, std::vector<BodyHandle>& hits)
+{
+	const b2BroadPhase& broad_phase = world.GetContactManager().m_broadPhase;
+	OverlapCallback callback(broad_phase, box, hits);
+	broad_phase.Query(&callback, box);
+}
@@ -0,0 +1,62 @@
+#ifndef BATCH_QUERY_H
+#define BATCH_QUERY_H
+
+#include <box2d/box2d.h>
+#include <vector>
+#include "body_store.h"
+
+// Rays cast together by SimulationManager::castRays, e.g. line of sight checks. The
+// caller fills origins/ends, and the closest hit of ray i is written at index i of the
+// result arrays. The arrays keep their capacity from one batch to the next, so a
+// batch reused every frame does not allocate.
+struct RayCastBatch
+{
+	std::vector<b2Vec2> origins;
+	std::vector<b2Vec2> ends;
+
+	// INVALID_BODY_HANDLE for the rays that hit nothing
+	std::vector<BodyHandle> handles;
+	std::vector<b2Vec2> points;
+	std::vector<b2Vec2> normals;
+	std::vector<float> fractions; // along origin -> end, 1 for a miss
+
+	unsigned int size() const { return static_cast<unsigned int>(origins.size()); }
+	void add(const b2Vec2& origin, const b2Vec2& end) { origins.push_back(origin); ends.push_back(end); }
+	// removes the rays, keeping the memory
+	void clear();
+	// sizes the results to the rays and marks every ray as a miss
+	void resetResults();
+};
+
+// Boxes queried together by SimulationManager::queryBoxes. The handles of the bodies
+// overlapping box i are hits[offsets[i]] to hits[offsets[i + 1] - 1], sorted by handle.
+struct BoxQueryBatch
+{
+	std::vector<b2AABB> boxes;
+
+	std::vector<unsigned int> offsets; // one more than boxes
+	std::vector<BodyHandle> hits;
+
+	unsigned int size() const { return static_cast<unsigned int>(boxes.size()); }
+	void add(const b2AABB& box) { boxes.push_back(box); }
+	void clear();
+
+	// hits of each chunk of boxes, concatenated into hits once every chunk is done
+	std::vector<std::vector<BodyHandle>> chunk_hits;
+	std::vector<unsigned int> counts; // hits of each box
+	void resetResults(unsigned int chunk_count);
+	void mergeChunks();
+};
+
+// Both walk the broadphase tree of the world directly, through Box2D's templated
+// callbacks, instead of b2World::RayCast/QueryAABB and their virtual callback objects.
+// Sensors are skipped.
+
+// casts rays [begin, end) of the batch against world, keeping the hits closer than the
+// ones already in the results (from another world)
+void castRays(const b2World& world, RayCastBatch& batch, unsigned int begin, unsigned int end);
+// appends the handles of the bodies whose fixtures overlap box. A body may be added
+// once per fixture
+void queryBox(const b2World& world, const b2AABB& box, std::vector<BodyHandle>& hits);
+
+#endif
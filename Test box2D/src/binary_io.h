@@ -0,0 +1,39 @@
+#ifndef BINARY_IO_H
+#define BINARY_IO_H
+
+#include <cstdint>
+#include <cstring>
+
+// Explicit little-endian encoding of the binary file formats (scene and world state
+// files), independent from the host byte order.
+
+inline void putU32(unsigned char* out, uint32_t value)
+{
+	out[0] = static_cast<unsigned char>(value);
+	out[1] = static_cast<unsigned char>(value >> 8);
+	out[2] = static_cast<unsigned char>(value >> 16);
+	out[3] = static_cast<unsigned char>(value >> 24);
+}
+
+inline void putF32(unsigned char* out, float value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	putU32(out, bits);
+}
+
+inline uint32_t getU32(const unsigned char* in)
+{
+	return static_cast<uint32_t>(in[0]) | static_cast<uint32_t>(in[1]) << 8 |
+		static_cast<uint32_t>(in[2]) << 16 | static_cast<uint32_t>(in[3]) << 24;
+}
+
+inline float getF32(const unsigned char* in)
+{
+	uint32_t bits = getU32(in);
+	float value;
+	std::memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+#endif
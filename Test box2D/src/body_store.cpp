@@ -0,0 +1,148 @@
+#include "body_store.h"
+
+const char* getBodyKindName(BodyKind kind)
+{
+	static const char* names[] = { "Box", "Wall", "Ball" };
+	return kind < BodyKind::COUNT ? names[static_cast<int>(kind)] : "";
+}
+
+void BodyStore::add(BodyHandle handle, b2Body* body, BodyKind kind, const glm::vec2& dimensions, const glm::vec3& color)
+{
+	handle_to_index[handle] = static_cast<int>(bodies.size());
+
+	handles.push_back(handle);
+	bodies.push_back(body);
+	kinds.push_back(kind);
+	this->dimensions.push_back(dimensions);
+	colors.push_back(color);
+	texture_ids.push_back(static_cast<unsigned int>(kind));
+	previous_positions.push_back(body->GetPosition());
+	previous_angles.push_back(body->GetAngle());
+}
+
+void BodyStore::remove(BodyHandle handle)
+{
+	int index = indexOf(handle);
+	if (index < 0)
+		return;
+	// move the last entry into the freed slot
+	unsigned int last = size() - 1;
+	if (static_cast<unsigned int>(index) != last)
+	{
+		handles[index] = handles[last];
+		bodies[index] = bodies[last];
+		kinds[index] = kinds[last];
+		dimensions[index] = dimensions[last];
+		colors[index] = colors[last];
+		texture_ids[index] = texture_ids[last];
+		previous_positions[index] = previous_positions[last];
+		previous_angles[index] = previous_angles[last];
+		handle_to_index[handles[index]] = index;
+	}
+	handle_to_index.erase(handle);
+
+	handles.pop_back();
+	bodies.pop_back();
+	kinds.pop_back();
+	dimensions.pop_back();
+	colors.pop_back();
+	texture_ids.pop_back();
+	previous_positions.pop_back();
+	previous_angles.pop_back();
+}
+
+int BodyStore::indexOf(BodyHandle handle) const
+{
+	auto found = handle_to_index.find(handle);
+	return found != handle_to_index.end() ? found->second : -1;
+}
+
+void BodyStore::clear()
+{
+	handle_to_index.clear();
+	handles.clear();
+	bodies.clear();
+	kinds.clear();
+	dimensions.clear();
+	colors.clear();
+	texture_ids.clear();
+	previous_positions.clear();
+	previous_angles.clear();
+}
+
+void BodyStore::reserve(unsigned int count)
+{
+	handle_to_index.reserve(count);
+	handles.reserve(count);
+	bodies.reserve(count);
+	kinds.reserve(count);
+	dimensions.reserve(count);
+	colors.reserve(count);
+	texture_ids.reserve(count);
+	previous_positions.reserve(count);
+	previous_angles.reserve(count);
+}
+
+void BodyStore::storePreviousTransforms()
+{
+	for (unsigned int i = 0; i < bodies.size(); i++)
+		storePreviousTransform(i);
+}
+
+void BodyStore::storePreviousTransform(unsigned int index)
+{
+	const b2Transform& transform = bodies[index]->GetTransform();
+	previous_positions[index] = transform.p;
+	previous_angles[index] = bodies[index]->GetAngle();
+}
+
+void BodySnapshot::capture(const BodyStore& store)
+{
+	handles = store.handles;
+	kinds = store.kinds;
+	dimensions = store.dimensions;
+	colors = store.colors;
+	texture_ids = store.texture_ids;
+	previous_positions = store.previous_positions;
+	previous_angles = store.previous_angles;
+	positions.resize(store.size());
+	angles.resize(store.size());
+	for (unsigned int i = 0; i < store.size(); i++)
+	{
+		positions[i] = store.bodies[i]->GetPosition();
+		angles[i] = store.bodies[i]->GetAngle();
+	}
+}
+
+void BodySnapshot::capture(const BodyStore& store, const std::vector<unsigned int>& indices)
+{
+	const size_t count = indices.size();
+	handles.resize(count);
+	kinds.resize(count);
+	dimensions.resize(count);
+	colors.resize(count);
+	texture_ids.resize(count);
+	positions.resize(count);
+	angles.resize(count);
+	previous_positions.resize(count);
+	previous_angles.resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		const unsigned int index = indices[i];
+		handles[i] = store.handles[index];
+		kinds[i] = store.kinds[index];
+		dimensions[i] = store.dimensions[index];
+		colors[i] = store.colors[index];
+		texture_ids[i] = store.texture_ids[index];
+		positions[i] = store.bodies[index]->GetPosition();
+		angles[i] = store.bodies[index]->GetAngle();
+		previous_positions[i] = store.previous_positions[index];
+		previous_angles[i] = store.previous_angles[index];
+	}
+}
+
+float BodySnapshot::getInterpolationAlpha(std::chrono::steady_clock::time_point now) const
+{
+	float alpha = std::chrono::duration<float>(now - step_time).count() / time_step;
+	return alpha < 0.0f ? 0.0f : (alpha > 1.0f ? 1.0f : alpha);
+}
@@ -0,0 +1,97 @@
+#ifndef BODY_STORE_H
+#define BODY_STORE_H
+
+#include <box2d/box2d.h>
+#include <chrono>
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <vector>
+
+// kinds of bodies that can be created from the canva
+enum class BodyKind : unsigned char
+{
+	BOX,
+	WALL,
+	BALL,
+	COUNT
+};
+
+// display name of a body kind ("Box", "Wall", "Ball")
+const char* getBodyKindName(BodyKind kind);
+
+// Stable integer handle of a body. Handles are handed out by the SimulationManager,
+// are never reused and are also stored in b2Body::GetUserData().pointer, so a
+// b2Body can be mapped back to its entry. 0 is never a valid handle.
+typedef unsigned int BodyHandle;
+const BodyHandle INVALID_BODY_HANDLE = 0;
+
+// Dense structure-of-arrays registry of the simulated bodies. Index i refers to the
+// same body in every array, so per-frame passes are linear sweeps over contiguous
+// memory. Removing a body moves the last one into its slot: indices are not stable,
+// handles are.
+class BodyStore {
+public:
+	std::vector<BodyHandle> handles;
+	std::vector<b2Body*> bodies;
+	std::vector<BodyKind> kinds;
+	std::vector<glm::vec2> dimensions; // box width/height, or the circle diameter
+	std::vector<glm::vec3> colors;
+	std::vector<unsigned int> texture_ids; // slot in the texture table of the renderer
+	// transform of the previous physics step, for interpolated rendering
+	std::vector<b2Vec2> previous_positions;
+	std::vector<float> previous_angles;
+
+	unsigned int size() const { return static_cast<unsigned int>(bodies.size()); }
+	// adds a body under the given handle; the texture slot defaults to the body kind
+	void add(BodyHandle handle, b2Body* body, BodyKind kind, const glm::vec2& dimensions, const glm::vec3& color);
+	// removes the body from the store. The b2Body itself is not destroyed
+	void remove(BodyHandle handle);
+	// returns the dense index of the handle, or -1 if it is not in the store
+	int indexOf(BodyHandle handle) const;
+	// empties the store, including the handle table
+	void clear();
+	void reserve(unsigned int count);
+
+	// copies the current transforms into previous_positions/previous_angles
+	void storePreviousTransforms();
+	// same for a single body, used when it is teleported by the editor
+	void storePreviousTransform(unsigned int index);
+	b2Vec2 getInterpolatedPosition(unsigned int index, float alpha) const { return (1.0f - alpha) * previous_positions[index] + alpha * bodies[index]->GetPosition(); }
+	float getInterpolatedAngle(unsigned int index, float alpha) const { return (1.0f - alpha) * previous_angles[index] + alpha * bodies[index]->GetAngle(); }
+private:
+	// index of each handle in the store. Handles are never reused, so a table indexed by
+	// handle would keep growing with every body ever created; the map only holds the
+	// bodies in the store
+	std::unordered_map<BodyHandle, int> handle_to_index;
+};
+
+// Copy of the render data of a BodyStore at the end of a physics step. Snapshots are
+// published by the simulation thread and read by the renderer, so the renderer
+// never touches the b2World while it is being stepped.
+struct BodySnapshot {
+	std::vector<BodyHandle> handles;
+	std::vector<BodyKind> kinds;
+	std::vector<glm::vec2> dimensions;
+	std::vector<glm::vec3> colors;
+	std::vector<unsigned int> texture_ids;
+	std::vector<b2Vec2> positions;
+	std::vector<float> angles;
+	std::vector<b2Vec2> previous_positions;
+	std::vector<float> previous_angles;
+	unsigned int total_bodies = 0; // bodies in the world, the snapshot may hold only the visible ones
+	std::chrono::steady_clock::time_point step_time; // when the last step was taken
+	float time_step = 1.0f / 60.0f;
+	unsigned long long step_count = 0;
+
+	unsigned int size() const { return static_cast<unsigned int>(handles.size()); }
+	// copies the store, reusing the memory of the previous capture
+	void capture(const BodyStore& store);
+	// copies only the bodies at the given indices of the store, in that order
+	void capture(const BodyStore& store, const std::vector<unsigned int>& indices);
+	// fraction of a step elapsed since the last step, clamped to [0, 1]
+	float getInterpolationAlpha(std::chrono::steady_clock::time_point now) const;
+	b2Vec2 getInterpolatedPosition(unsigned int index, float alpha) const { return (1.0f - alpha) * previous_positions[index] + alpha * positions[index]; }
+	float getInterpolatedAngle(unsigned int index, float alpha) const { return (1.0f - alpha) * previous_angles[index] + alpha * angles[index]; }
+};
+
+#endif
@@ -0,0 +1,94 @@
+#include "camera_2d.h"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+Camera2D::Camera2D(glm::vec2 viewport_size, float pixels_per_unit)
+	: viewport_size(viewport_size), pixels_per_unit(pixels_per_unit)
+{
+	reset();
+}
+
+Camera2D::~Camera2D()
+{
+	if (uniform_buffer != 0)
+		glDeleteBuffers(1, &uniform_buffer);
+}
+
+void Camera2D::init()
+{
+	if (uniform_buffer != 0)
+		return;
+	glGenBuffers(1, &uniform_buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, uniform_buffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(glm::mat4), nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glBindBufferBase(GL_UNIFORM_BUFFER, UNIFORM_BINDING, uniform_buffer);
+}
+
+void Camera2D::uploadUniforms()
+{
+	glm::mat4 view_projection = getViewProjection();
+	if (view_projection == uploaded_matrix)
+		return;
+	glBindBuffer(GL_UNIFORM_BUFFER, uniform_buffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glm::mat4), glm::value_ptr(view_projection));
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	uploaded_matrix = view_projection;
+}
+
+void Camera2D::reset()
+{
+	// same view as a pixel projection over the viewport
+	zoom = 1.0f;
+	rotation = 0.0f;
+	position = getViewSize() / 2.0f;
+}
+
+glm::vec2 Camera2D::getViewSize() const
+{
+	return viewport_size / (pixels_per_unit * zoom);
+}
+
+glm::mat4 Camera2D::getViewProjection() const
+{
+	// bottom and top are swapped so that y points down
+	glm::vec2 half = getViewSize() / 2.0f;
+	glm::mat4 projection = glm::ortho(-half.x, half.x, half.y, -half.y, -1.0f, 1.0f);
+	glm::mat4 view = glm::rotate(glm::mat4(1.0f), -rotation, glm::vec3(0.0f, 0.0f, 1.0f));
+	view = glm::translate(view, glm::vec3(-position, 0.0f));
+	return projection * view;
+}
+
+void Camera2D::getVisibleBounds(glm::vec2& lower, glm::vec2& upper) const
+{
+	// half extents of the rotated view rectangle
+	glm::vec2 half = getViewSize() / 2.0f;
+	float c = std::abs(std::cos(rotation));
+	float s = std::abs(std::sin(rotation));
+	glm::vec2 extent(c * half.x + s * half.y, s * half.x + c * half.y);
+	lower = position - extent;
+	upper = position + extent;
+}
+
+glm::vec2 Camera2D::viewToWorld(glm::vec2 view_point) const
+{
+	glm::vec2 local = (view_point - 0.5f) * getViewSize();
+	float c = std::cos(rotation);
+	float s = std::sin(rotation);
+	return position + glm::vec2(c * local.x - s * local.y, s * local.x + c * local.y);
+}
+
+void Camera2D::pan(glm::vec2 view_delta)
+{
+	position -= viewToWorld(view_delta + 0.5f) - position;
+}
+
+void Camera2D::zoomAt(float factor, glm::vec2 view_point)
+{
+	glm::vec2 anchor = viewToWorld(view_point);
+	zoom = std::clamp(zoom * factor, MIN_ZOOM, MAX_ZOOM);
+	position += anchor - viewToWorld(view_point);
+}
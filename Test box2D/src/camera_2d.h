@@ -0,0 +1,57 @@
+#ifndef CAMERA_2D_H
+#define CAMERA_2D_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// Camera looking at the Box2D world. The view spans viewport_size pixels and a world unit
+// covers pixels_per_unit pixels at zoom 1. As on the canva, y points down.
+// The view-projection matrix is shared by the scene shaders through the std140 uniform block
+//     layout (std140) uniform Camera { mat4 viewProjection; };
+// bound to UNIFORM_BINDING, and uploaded once per frame with uploadUniforms()
+class Camera2D {
+public:
+	static const unsigned int UNIFORM_BINDING = 0;
+	static constexpr float MIN_ZOOM = 0.02f;
+	static constexpr float MAX_ZOOM = 50.0f;
+
+	glm::vec2 position; // world point at the center of the view
+	float zoom = 1.0f;
+	float rotation = 0.0f; // radians
+
+	Camera2D(glm::vec2 viewport_size, float pixels_per_unit);
+	~Camera2D();
+	Camera2D(const Camera2D&) = delete;
+	Camera2D& operator=(const Camera2D&) = delete;
+
+	// creates the uniform buffer and binds it to UNIFORM_BINDING, needs a current GL context
+	void init();
+	// uploads the view-projection matrix, only if the camera moved since the last upload
+	void uploadUniforms();
+	// back to the default view: world origin in the top left corner, zoom 1, no rotation
+	void reset();
+
+	void setViewportSize(glm::vec2 size) { viewport_size = size; }
+	glm::vec2 getViewportSize() const { return viewport_size; }
+	// world-space size of the view
+	glm::vec2 getViewSize() const;
+	glm::mat4 getViewProjection() const;
+	// world-space box containing the whole view, rotated or not
+	void getVisibleBounds(glm::vec2& lower, glm::vec2& upper) const;
+
+	// maps a point of the view, from (0, 0) top left to (1, 1) bottom right, to world space
+	glm::vec2 viewToWorld(glm::vec2 view_point) const;
+	// moves the camera by an offset given in view units, so that dragging the mouse by
+	// view_delta keeps the same world point under the cursor
+	void pan(glm::vec2 view_delta);
+	// scales the zoom by factor, keeping the world point under view_point in place
+	void zoomAt(float factor, glm::vec2 view_point);
+
+private:
+	glm::vec2 viewport_size;
+	float pixels_per_unit;
+	GLuint uniform_buffer = 0;
+	glm::mat4 uploaded_matrix = glm::mat4(0.0f); // matrix in uniform_buffer
+};
+
+#endif
@@ -0,0 +1,134 @@
+#include "canvas.h"
+
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <glm/glm.hpp>
+#include "frame_arena.h"
+
+void saveCanvasFile(const std::string& filePath, const CanvasShapes& shapes)
+{
+    std::ofstream outfile(filePath, std::ios_base::out | std::ios_base::trunc);
+
+    outfile << "{" << '\n';
+
+    CanvasShapes::const_iterator shapes_it;
+    for (shapes_it = shapes.begin(); shapes_it !=shapes.end(); shapes_it++)
+    {
+        outfile << "\t[" << shapes_it->first << "]:\n\t{\n";
+        for (auto& shape : shapes_it->second)
+        {
+            outfile << "\t\t";
+            outfile << shape.name << "," << "(" << shape.p1.x << ", " << shape.p1.y << "), " << "(" << shape.p2.x << ", " << shape.p2.y << "), "
+                << "(" << shape.color.x << "," << shape.color.y << "," << shape.color.z << "," << shape.color.w << "),"
+                << shape.type << "," << shape.area << "," << shape.rotation << " \n";
+        }
+        outfile << "\t}\n";
+    }
+    outfile << "}";
+}
+
+bool loadCanvasFile(const std::string& filePath, CanvasShapes* shapes)
+{
+    std::ifstream infile(filePath, std::ios_base::in);
+    std::string buffer;
+    // the numbers and the name of a line only live until the next line
+    FrameArena line_arena(4096);
+
+    int element_number{};
+    if (!infile.is_open())
+        return false;
+    (*shapes).clear();
+
+    while (infile)
+    {
+        std::getline(infile, buffer);
+        for (unsigned int i = 0; i < buffer.length(); i++)
+        {
+            if (buffer[i] == '[')
+                element_number = int(buffer[i + 1] - '0'); // converts char to int
+            else if (buffer[i] == '\t' && buffer[i + 1] == '\t')
+            {
+                line_arena.reset();
+                FrameVector<float> values(line_arena);
+                values.reserve(16);
+                FrameString b(line_arena);
+                FrameString name(line_arena);
+                for (auto& el : buffer)
+                {
+                    if (std::isdigit(el) || el == '.') // retrieves numbers
+                        b += el;
+                    else if (!std::isdigit(el) && !b.empty()) // saves the number
+                    {
+                        values.push_back(std::strtof(b.c_str(), nullptr));
+                        b.clear();
+                    }
+                    else if (std::isalpha(el)) // retrieves object's name
+                        name += el;
+                }
+                Shape_t shape;
+                shape.name.assign(name.data(), name.size());
+                shape.p1 = ImVec2(values[0], values[1]);
+                shape.p2 = ImVec2(values[2], values[3]);
+                shape.color = ImVec4(values[4], values[5], values[6], values[7]);
+                shape.type = (b2BodyType)values[8];
+                shape.area = values[9];
+                shape.rotation = values[10];
+                (*shapes)[element_number].push_back(shape);
+            }
+        }
+    }
+    return true;
+}
+
+BodyHandle createBoxObject(SimulationManager& simulation_manager, const Shape_t& shape)
+{
+    const float RENDER_SCALE = simulation_manager.getRenderScale();
+    return simulation_manager.createBox(glm::vec2((shape.p1.x + shape.p2.x) / 2 / RENDER_SCALE, (shape.p1.y + shape.p2.y) / 2 / RENDER_SCALE), glm::vec2(std::abs(shape.p1.x - shape.p2.x) / RENDER_SCALE, std::abs(shape.p1.y - shape.p2.y) / RENDER_SCALE), glm::radians(-shape.rotation));
+}
+
+BodyHandle createWallObject(SimulationManager& simulation_manager, const Shape_t& shape)
+{
+    const float RENDER_SCALE = simulation_manager.getRenderScale();
+    return simulation_manager.createWall(glm::vec2((shape.p1.x + shape.p2.x) / 2 / RENDER_SCALE, (shape.p1.y + shape.p2.y) / 2 / RENDER_SCALE), glm::vec2(std::abs(shape.p1.x - shape.p2.x) / RENDER_SCALE, std::abs(shape.p1.y - shape.p2.y) / RENDER_SCALE), glm::radians(-shape.rotation));
+}
+
+BodyHandle createCircleObject(SimulationManager& simulation_manager, const Shape_t& shape)
+{
+    const float RENDER_SCALE = simulation_manager.getRenderScale();
+    return simulation_manager.createCircle(glm::vec2(shape.p1.x / RENDER_SCALE, shape.p1.y / RENDER_SCALE), sqrt(pow(shape.p1.x - shape.p2.x, 2) + pow(shape.p1.y - shape.p2.y, 2)) / RENDER_SCALE, shape.type);
+}
+
+void createCanvasObjects(SimulationManager& simulation_manager, CanvasShapes& shapes)
+{
+    unsigned int count = 0;
+    for (auto& group : shapes)
+        count += static_cast<unsigned int>(group.second.size());
+    simulation_manager.reserveBodies(count);
+
+    CanvasShapes::iterator shapes_it;
+    for (shapes_it = shapes.begin(); shapes_it != shapes.end(); shapes_it++)
+    {
+        for (auto& shape : shapes_it->second)
+        {
+            switch (shape.type)
+            {
+            case b2_dynamicBody:
+                if (shape.name == "Box")
+                    shape.body = createBoxObject(simulation_manager, shape);
+                else if (shape.name == "Ball")
+                    shape.body = createCircleObject(simulation_manager, shape);
+                break;
+            case b2_staticBody:
+                if (shape.name == "Wall")
+                    shape.body = createWallObject(simulation_manager, shape);
+                else if (shape.name == "Ball")
+                    shape.body = createCircleObject(simulation_manager, shape);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef CANVAS_H
+#define CANVAS_H
+
+#include <box2d/box2d.h>
+#include <imgui/imgui.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "simulation_manager.h"
+
+// Canvas data and the functions turning it into Box2D bodies. Nothing in here
+// depends on OpenGL or GLFW, so the same code is shared by the editor and by the
+// headless runner. Only the ImVec2/ImVec4 value types are taken from imgui.h.
+
+// structure for holding shape data for drawing
+// p1: top-left corner, p2: bottom-right corner, color: shape color
+typedef struct Shape {
+    std::string name;
+    ImVec2 p1;
+    ImVec2 p2;
+    ImVec4 color;
+    b2BodyType type;
+    float area;
+    float rotation;
+    BodyHandle body = INVALID_BODY_HANDLE; // Box2D body created from this shape
+
+    void reset()
+    {
+        p1 = ImVec2(0.0f, 0.0f);
+        p2 = ImVec2(0.0f, 0.0f);
+        area = -1.0f;
+    }
+} Shape_t;
+
+// shapes in the canva, keyed by kind (0: line, 1: rectangle, 2: circle)
+typedef std::map<int, std::vector<Shape_t>> CanvasShapes;
+
+// save a canva sketch to file
+void saveCanvasFile(const std::string& filePath, const CanvasShapes& shapes);
+// loads a canva sketch form file. Returns false if the file couldn't be opened
+bool loadCanvasFile(const std::string& filePath, CanvasShapes* shapes);
+// creates a box Box2D object from a canva sketch
+BodyHandle createBoxObject(SimulationManager& simulation_manager, const Shape_t& shape);
+// creates a static Box2D object 
+BodyHandle createWallObject(SimulationManager& simulation_manager, const Shape_t& shape);
+// creates a circle Box2D object
+BodyHandle createCircleObject(SimulationManager& simulation_manager, const Shape_t& shape);
+// creates the Box2D objects for every shape in the canva and stores their handles in the shapes
+void createCanvasObjects(SimulationManager& simulation_manager, CanvasShapes& shapes);
+
+#endif
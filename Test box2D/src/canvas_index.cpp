@@ -0,0 +1,170 @@
+#include "canvas_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// the proxy user data packs the shape position, not a pointer: the shape vectors reallocate
+static void* packRef(int group, unsigned int index)
+{
+    return reinterpret_cast<void*>(static_cast<uintptr_t>(index) * CanvasIndex::GROUP_COUNT + group);
+}
+
+static ShapeRef unpackRef(void* user_data)
+{
+    uintptr_t value = reinterpret_cast<uintptr_t>(user_data);
+    return ShapeRef{ static_cast<int>(value % CanvasIndex::GROUP_COUNT), static_cast<unsigned int>(value / CanvasIndex::GROUP_COUNT) };
+}
+
+// collects the proxies overlapping a query box, see b2DynamicTree::Query
+struct CollectCallback {
+    const b2DynamicTree* tree;
+    std::vector<ShapeRef>* result;
+    bool QueryCallback(int32 proxy_id)
+    {
+        result->push_back(unpackRef(tree->GetUserData(proxy_id)));
+        return true;
+    }
+};
+
+void CanvasIndex::build(const CanvasShapes& shapes)
+{
+    clear();
+    for (auto& group : shapes)
+    {
+        if (group.first < 0 || group.first >= GROUP_COUNT)
+            continue;
+        m_proxies[group.first].reserve(group.second.size());
+        for (unsigned int i = 0; i < group.second.size(); i++)
+            insert(group.first, i, group.second[i]);
+    }
+}
+
+void CanvasIndex::clear()
+{
+    for (int group = 0; group < GROUP_COUNT; group++)
+    {
+        for (int proxy : m_proxies[group])
+            m_tree.DestroyProxy(proxy);
+        m_proxies[group].clear();
+    }
+}
+
+void CanvasIndex::insert(int group, unsigned int index, const Shape_t& shape)
+{
+    if (group < 0 || group >= GROUP_COUNT || index != m_proxies[group].size())
+        return;
+    m_proxies[group].push_back(m_tree.CreateProxy(getBounds(group, shape), packRef(group, index)));
+}
+
+void CanvasIndex::update(int group, unsigned int index, const Shape_t& shape)
+{
+    if (group < 0 || group >= GROUP_COUNT || index >= m_proxies[group].size())
+        return;
+    int proxy = m_proxies[group][index];
+    b2AABB bounds = getBounds(group, shape);
+    const b2AABB& old_bounds = m_tree.GetFatAABB(proxy);
+    // the displacement lets the tree enlarge the box in the direction of a drag
+    b2Vec2 displacement = bounds.GetCenter() - old_bounds.GetCenter();
+    m_tree.MoveProxy(proxy, bounds, displacement);
+}
+
+void CanvasIndex::removeLast(int group)
+{
+    if (group < 0 || group >= GROUP_COUNT || m_proxies[group].empty())
+        return;
+    m_tree.DestroyProxy(m_proxies[group].back());
+    m_proxies[group].pop_back();
+}
+
+void CanvasIndex::query(const ImVec2& lower, const ImVec2& upper, std::vector<ShapeRef>* result) const
+{
+    result->clear();
+    b2AABB box;
+    box.lowerBound.Set(std::min(lower.x, upper.x), std::min(lower.y, upper.y));
+    box.upperBound.Set(std::max(lower.x, upper.x), std::max(lower.y, upper.y));
+    CollectCallback callback{ &m_tree, result };
+    m_tree.Query(&callback, box);
+    // the tree returns the proxies in no particular order
+    std::sort(result->begin(), result->end());
+}
+
+bool CanvasIndex::pick(const CanvasShapes& shapes, const ImVec2& point, ShapeRef* result, float tolerance) const
+{
+    std::vector<ShapeRef> candidates;
+    query(ImVec2(point.x - tolerance, point.y - tolerance), ImVec2(point.x + tolerance, point.y + tolerance), &candidates);
+    // last drawn first
+    for (auto it = candidates.rbegin(); it != candidates.rend(); it++)
+    {
+        auto group = shapes.find(it->group);
+        if (group == shapes.end() || it->index >= group->second.size())
+            continue;
+        if (contains(it->group, group->second[it->index], point, tolerance))
+        {
+            *result = *it;
+            return true;
+        }
+    }
+    return false;
+}
+
+unsigned int CanvasIndex::size() const
+{
+    unsigned int count = 0;
+    for (int group = 0; group < GROUP_COUNT; group++)
+        count += static_cast<unsigned int>(m_proxies[group].size());
+    return count;
+}
+
+b2AABB CanvasIndex::getBounds(int group, const Shape_t& shape)
+{
+    b2AABB bounds;
+    if (group == 2)
+    {
+        // circle centered in p1 through p2
+        float radius = std::sqrt((shape.p1.x - shape.p2.x) * (shape.p1.x - shape.p2.x) + (shape.p1.y - shape.p2.y) * (shape.p1.y - shape.p2.y));
+        bounds.lowerBound.Set(shape.p1.x - radius, shape.p1.y - radius);
+        bounds.upperBound.Set(shape.p1.x + radius, shape.p1.y + radius);
+    }
+    else if (group == 1)
+    {
+        // rectangle rotated around its center, see drawRotatedQuad
+        float angle = glm::radians(-shape.rotation);
+        float c = std::abs(std::cos(angle)), s = std::abs(std::sin(angle));
+        float half_width = std::abs(shape.p2.x - shape.p1.x) / 2.0f, half_height = std::abs(shape.p2.y - shape.p1.y) / 2.0f;
+        b2Vec2 center((shape.p1.x + shape.p2.x) / 2.0f, (shape.p1.y + shape.p2.y) / 2.0f);
+        b2Vec2 extents(c * half_width + s * half_height, s * half_width + c * half_height);
+        bounds.lowerBound = center - extents;
+        bounds.upperBound = center + extents;
+    }
+    else
+    {
+        bounds.lowerBound.Set(std::min(shape.p1.x, shape.p2.x), std::min(shape.p1.y, shape.p2.y));
+        bounds.upperBound.Set(std::max(shape.p1.x, shape.p2.x), std::max(shape.p1.y, shape.p2.y));
+    }
+    return bounds;
+}
+
+bool CanvasIndex::contains(int group, const Shape_t& shape, const ImVec2& point, float tolerance)
+{
+    glm::vec2 p(point.x, point.y);
+    glm::vec2 p1(shape.p1.x, shape.p1.y);
+    glm::vec2 p2(shape.p2.x, shape.p2.y);
+    if (group == 2)
+        return glm::length(p - p1) <= glm::length(p2 - p1) + tolerance;
+    if (group == 1)
+    {
+        // back into the frame of the unrotated rectangle
+        glm::vec2 center = (p1 + p2) / 2.0f;
+        float angle = glm::radians(shape.rotation);
+        glm::vec2 d = p - center;
+        glm::vec2 local(std::cos(angle) * d.x - std::sin(angle) * d.y, std::sin(angle) * d.x + std::cos(angle) * d.y);
+        return std::abs(local.x) <= std::abs(p2.x - p1.x) / 2.0f && std::abs(local.y) <= std::abs(p2.y - p1.y) / 2.0f;
+    }
+    // distance to the segment
+    glm::vec2 segment = p2 - p1;
+    float length2 = glm::dot(segment, segment);
+    float t = length2 > 0.0f ? glm::clamp(glm::dot(p - p1, segment) / length2, 0.0f, 1.0f) : 0.0f;
+    return glm::length(p - (p1 + t * segment)) <= tolerance;
+}
@@ -0,0 +1,53 @@
+#ifndef CANVAS_INDEX_H
+#define CANVAS_INDEX_H
+
+#include <box2d/box2d.h>
+#include <imgui/imgui.h>
+#include <map>
+#include <vector>
+#include "canvas.h"
+
+// position of a shape in the canva: group key in CanvasShapes and index in its vector
+struct ShapeRef {
+	int group;
+	unsigned int index;
+
+	bool operator<(const ShapeRef& other) const { return group < other.group || (group == other.group && index < other.index); }
+};
+
+// Spatial index over the bounds of the canva shapes, in canva coordinates, backed by
+// a b2DynamicTree. It answers rectangle queries (selection, visible area) and point
+// picking without walking every shape. The index mirrors CanvasShapes by position,
+// so it must be told about every shape added, moved, rotated or removed.
+class CanvasIndex {
+public:
+	static const int GROUP_COUNT = 3; // line, rectangle, circle
+
+	// drops every shape and indexes the whole canva
+	void build(const CanvasShapes& shapes);
+	void clear();
+	// indexes shapes[group][index], the last shape of its group
+	void insert(int group, unsigned int index, const Shape_t& shape);
+	// refreshes the bounds after the shape was moved or rotated
+	void update(int group, unsigned int index, const Shape_t& shape);
+	// removes the last shape of a group
+	void removeLast(int group);
+
+	// shapes whose bounds overlap the rectangle, sorted in drawing order
+	void query(const ImVec2& lower, const ImVec2& upper, std::vector<ShapeRef>* result) const;
+	// topmost shape under the point (the last drawn one), tolerance in pixels for lines.
+	// Returns false if there is none
+	bool pick(const CanvasShapes& shapes, const ImVec2& point, ShapeRef* result, float tolerance = 4.0f) const;
+
+	unsigned int size() const;
+	// bounds of a shape, rotation included
+	static b2AABB getBounds(int group, const Shape_t& shape);
+	// true if the point lies on the shape itself, not only in its bounds
+	static bool contains(int group, const Shape_t& shape, const ImVec2& point, float tolerance);
+
+private:
+	b2DynamicTree m_tree;
+	std::vector<int> m_proxies[GROUP_COUNT]; // proxy of shapes[group][index]
+};
+
+#endif
@@ -0,0 +1,156 @@
+#include "file_watcher.h"
+
+#include <algorithm>
+#include <iostream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	void addChanged(std::vector<std::string>& changed, const std::string& path)
+	{
+		if (std::find(changed.begin(), changed.end(), path) == changed.end())
+			changed.push_back(path);
+	}
+}
+
+#ifdef _WIN32
+FileWatcher::FileWatcher()
+{
+}
+
+FileWatcher::~FileWatcher()
+{
+	for (WatchedDirectory& directory : m_directories)
+		FindCloseChangeNotification(directory.notification);
+}
+
+bool FileWatcher::watch(const std::string& path)
+{
+	std::error_code error;
+	std::filesystem::path file = std::filesystem::absolute(path, error).lexically_normal();
+	if (error)
+		return false;
+	std::filesystem::path directory_path = file.parent_path();
+	auto directory = std::find_if(m_directories.begin(), m_directories.end(),
+		[&](const WatchedDirectory& d) { return d.path == directory_path; });
+	if (directory == m_directories.end())
+	{
+		HANDLE notification = FindFirstChangeNotificationW(directory_path.c_str(), FALSE,
+			FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME);
+		if (notification == INVALID_HANDLE_VALUE)
+		{
+			std::cout << "ERROR::FILE_WATCHER: can't watch " << directory_path.string() << std::endl;
+			return false;
+		}
+		WatchedDirectory watched;
+		watched.path = directory_path;
+		watched.notification = notification;
+		m_directories.push_back(std::move(watched));
+		directory = m_directories.end() - 1;
+	}
+	std::string name = file.filename().string();
+	directory->files[name] = path;
+	directory->write_times[name] = std::filesystem::last_write_time(file, error);
+	return true;
+}
+
+void FileWatcher::poll(std::vector<std::string>& changed)
+{
+	// the notifications only tell that something changed in a directory, the modification
+	// times of its watched files tell what
+	for (WatchedDirectory& directory : m_directories)
+	{
+		if (WaitForSingleObject(directory.notification, 0) != WAIT_OBJECT_0)
+			continue;
+		FindNextChangeNotification(directory.notification);
+		for (auto& [name, path] : directory.files)
+		{
+			std::error_code error;
+			auto write_time = std::filesystem::last_write_time(directory.path / name, error);
+			if (error || write_time == directory.write_times[name])
+				continue;
+			directory.write_times[name] = write_time;
+			addChanged(changed, path);
+		}
+	}
+}
+#else
+FileWatcher::FileWatcher()
+{
+	m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (m_inotify < 0)
+		std::cout << "ERROR::FILE_WATCHER: inotify is not available" << std::endl;
+}
+
+FileWatcher::~FileWatcher()
+{
+	if (m_inotify >= 0)
+		close(m_inotify);
+}
+
+bool FileWatcher::watch(const std::string& path)
+{
+	if (m_inotify < 0)
+		return false;
+	std::error_code error;
+	std::filesystem::path file = std::filesystem::absolute(path, error).lexically_normal();
+	if (error)
+		return false;
+	std::filesystem::path directory_path = file.parent_path();
+	auto directory = std::find_if(m_directories.begin(), m_directories.end(),
+		[&](const WatchedDirectory& d) { return d.path == directory_path; });
+	if (directory == m_directories.end())
+	{
+		// a file is complete once closed after writing, or once renamed into place
+		int descriptor = inotify_add_watch(m_inotify, directory_path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+		if (descriptor < 0)
+		{
+			std::cout << "ERROR::FILE_WATCHER: can't watch " << directory_path.string() << std::endl;
+			return false;
+		}
+		WatchedDirectory watched;
+		watched.path = directory_path;
+		watched.descriptor = descriptor;
+		m_directories.push_back(std::move(watched));
+		directory = m_directories.end() - 1;
+	}
+	directory->files[file.filename().string()] = path;
+	return true;
+}
+
+void FileWatcher::poll(std::vector<std::string>& changed)
+{
+	if (m_inotify < 0)
+		return;
+	alignas(inotify_event) char buffer[4096];
+	for (;;)
+	{
+		ssize_t length = read(m_inotify, buffer, sizeof(buffer));
+		if (length <= 0)
+			break;
+		for (ssize_t offset = 0; offset < length; )
+		{
+			const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+			offset += sizeof(inotify_event) + event->len;
+			if (event->len == 0)
+				continue;
+			for (const WatchedDirectory& directory : m_directories)
+			{
+				if (directory.descriptor != event->wd)
+					continue;
+				auto file = directory.files.find(event->name);
+				if (file != directory.files.end())
+					addChanged(changed, file->second);
+			}
+		}
+	}
+}
+#endif
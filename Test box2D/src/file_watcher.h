@@ -0,0 +1,41 @@
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+// Reports changes to a set of files without blocking. The directories holding the files
+// are watched (inotify on Linux, change notifications on Windows), so that editors saving
+// through a temporary file renamed over the original are caught as well.
+class FileWatcher {
+public:
+	FileWatcher();
+	~FileWatcher();
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	// starts watching a file, returns false if its directory can't be watched
+	bool watch(const std::string& path);
+	// appends the watched files changed since the last call, as they were passed to watch()
+	void poll(std::vector<std::string>& changed);
+private:
+	struct WatchedDirectory {
+		std::filesystem::path path;
+		// file name -> path given to watch(), and its last modification time
+		std::map<std::string, std::string> files;
+		std::map<std::string, std::filesystem::file_time_type> write_times;
+#ifdef _WIN32
+		void* notification = nullptr;
+#else
+		int descriptor = -1;
+#endif
+	};
+	std::vector<WatchedDirectory> m_directories;
+#ifndef _WIN32
+	int m_inotify = -1;
+#endif
+};
+
+#endif
@@ -0,0 +1,55 @@
+#include "frame_arena.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+
+FrameArena::FrameArena(size_t capacity)
+{
+	m_capacity = capacity;
+	m_block = static_cast<unsigned char*>(std::malloc(capacity));
+	m_used = 0;
+	m_peak = 0;
+	m_overflow_bytes = 0;
+}
+
+FrameArena::~FrameArena()
+{
+	for (void* block : m_overflow)
+		std::free(block);
+	std::free(m_block);
+}
+
+void* FrameArena::allocate(size_t size, size_t alignment)
+{
+	const uintptr_t base = reinterpret_cast<uintptr_t>(m_block);
+	const size_t offset = ((base + m_used + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1)) - base;
+	if (offset + size <= m_capacity)
+	{
+		m_used = offset + size;
+		m_peak = std::max(m_peak, getUsed());
+		return m_block + offset;
+	}
+	// full: one heap block per allocation until the next reset grows the arena. malloc
+	// aligns for any fundamental type
+	void* block = std::malloc(std::max<size_t>(size, 1));
+	m_overflow.push_back(block);
+	m_overflow_bytes += size + alignment;
+	m_peak = std::max(m_peak, getUsed());
+	return block;
+}
+
+void FrameArena::reset()
+{
+	for (void* block : m_overflow)
+		std::free(block);
+	if (!m_overflow.empty())
+	{
+		std::free(m_block);
+		m_capacity = std::max(m_capacity * 2, m_peak);
+		m_block = static_cast<unsigned char*>(std::malloc(m_capacity));
+	}
+	m_overflow.clear();
+	m_overflow_bytes = 0;
+	m_used = 0;
+}
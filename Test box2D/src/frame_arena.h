@@ -0,0 +1,74 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Linear (bump) allocator for transient data: allocating moves a pointer forward in a
+// preallocated block, nothing is freed individually, and reset() releases everything at
+// once. The editor resets its arena at the end of every frame; a loader can reset one
+// per line. When a frame needs more than the block, the extra is taken from the heap
+// and the block grows to the peak at the next reset, so the steady state does not touch
+// the heap. Not thread safe.
+class FrameArena {
+public:
+	explicit FrameArena(size_t capacity = 1 << 20);
+	~FrameArena();
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+	// frees everything allocated since the last reset
+	void reset();
+
+	// bytes allocated since the last reset, including the overflow
+	size_t getUsed() const { return m_used + m_overflow_bytes; }
+	size_t getCapacity() const { return m_capacity; }
+	// most bytes used between two resets
+	size_t getPeak() const { return m_peak; }
+	// heap blocks taken since the last reset because the block was full
+	unsigned int getOverflows() const { return static_cast<unsigned int>(m_overflow.size()); }
+private:
+	unsigned char* m_block;
+	size_t m_capacity;
+	size_t m_used;
+	size_t m_peak;
+	std::vector<void*> m_overflow;
+	size_t m_overflow_bytes;
+};
+
+// standard allocator over a FrameArena, for the containers below. Deallocation does
+// nothing, the memory comes back with FrameArena::reset(): the containers must not
+// outlive the reset, and growing them leaves their previous buffers in the arena, so
+// they should be reserved up front
+template <typename T>
+class ArenaAllocator {
+public:
+	typedef T value_type;
+
+	ArenaAllocator(FrameArena& arena) : arena(&arena) {}
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+	T* allocate(size_t count) { return static_cast<T*>(arena->allocate(count * sizeof(T), alignof(T))); }
+	void deallocate(T*, size_t) {}
+
+	FrameArena* arena;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.arena == b.arena; }
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.arena != b.arena; }
+
+template <typename T>
+using FrameVector = std::vector<T, ArenaAllocator<T>>;
+typedef std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>> FrameString;
+template <typename Key, typename Value>
+using FrameHashMap = std::unordered_map<Key, Value, std::hash<Key>, std::equal_to<Key>, ArenaAllocator<std::pair<const Key, Value>>>;
+
+#endif
@@ -0,0 +1,114 @@
+#include "frame_pacer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#ifdef _WIN32
+// the default scheduler tick of ~15.6 ms is too coarse for sleeping inside a frame
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <timeapi.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+// the spin window is kept between these bounds (seconds)
+const float MIN_SPIN_THRESHOLD = 0.0002f;
+const float MAX_SPIN_THRESHOLD = 0.004f;
+
+FramePacer::FramePacer(float target_fps)
+    : m_mode(PacingMode::LIMITED), m_spin_threshold(0.001f)
+{
+#ifdef _WIN32
+    timeBeginPeriod(1);
+#endif
+    setTargetFPS(target_fps);
+    m_frame_start = clock::now();
+    m_work_done = m_frame_start;
+    m_deadline = m_frame_start + m_period;
+}
+
+FramePacer::~FramePacer()
+{
+#ifdef _WIN32
+    timeEndPeriod(1);
+#endif
+}
+
+void FramePacer::setMode(PacingMode mode)
+{
+    m_mode = mode;
+    m_deadline = clock::now() + m_period;
+}
+
+void FramePacer::setTargetFPS(float target_fps)
+{
+    m_target_fps = target_fps > 1.0f ? target_fps : 1.0f;
+    m_period = std::chrono::duration_cast<clock::duration>(seconds(1.0f / m_target_fps));
+    m_deadline = clock::now() + m_period;
+}
+
+void FramePacer::markWorkDone()
+{
+    m_work_done = clock::now();
+}
+
+void FramePacer::wait()
+{
+    clock::duration spun = clock::duration::zero();
+    if (m_mode == PacingMode::LIMITED)
+    {
+        // coarse part: one sleep up to the spin window, then measure how late the OS
+        // woke us up and widen or narrow the window accordingly
+        clock::time_point sleep_start = clock::now();
+        clock::time_point wake_target = m_deadline - std::chrono::duration_cast<clock::duration>(m_spin_threshold);
+        if (sleep_start < wake_target)
+        {
+            std::this_thread::sleep_until(wake_target);
+            clock::time_point woke = clock::now();
+            float oversleep = seconds(woke - wake_target).count();
+            // fast attack, slow release: one late wake-up widens the window immediately
+            float threshold = oversleep > m_spin_threshold.count() ? oversleep * 1.25f : m_spin_threshold.count() * 0.99f + oversleep * 0.01f;
+            m_spin_threshold = seconds(std::min(std::max(threshold, MIN_SPIN_THRESHOLD), MAX_SPIN_THRESHOLD));
+        }
+        // fine part
+        clock::time_point spin_start = clock::now();
+        while (clock::now() < m_deadline)
+            std::this_thread::yield();
+        spun = clock::now() - spin_start;
+
+        m_deadline += m_period;
+        // more than a frame behind (e.g. the window was dragged): start again from now
+        // instead of running a burst of unpaced frames to catch up
+        clock::time_point now = clock::now();
+        if (m_deadline < now)
+            m_deadline = now + m_period;
+    }
+
+    clock::time_point frame_end = clock::now();
+    // everything since the work was done that wasn't spinning: the sleep, and the
+    // time blocked in the buffer swap (all of the wait in VSYNC mode)
+    clock::duration slept = (frame_end - m_work_done) - spun;
+
+    m_frame_times.push(seconds(frame_end - m_frame_start).count() * 1000.0f);
+    m_work_times.push(seconds(m_work_done - m_frame_start).count() * 1000.0f);
+    m_sleep_times.push(seconds(slept).count() * 1000.0f);
+    m_spin_times.push(seconds(spun).count() * 1000.0f);
+    m_frame_start = frame_end;
+}
+
+float FramePacer::getJitter() const
+{
+    unsigned int count = m_frame_times.size();
+    if (count < 2)
+        return 0.0f;
+    float mean = m_frame_times.average();
+    float variance = 0.0f;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        float deviation = m_frame_times.at(i) - mean;
+        variance += deviation * deviation;
+    }
+    return std::sqrt(variance / (count - 1));
+}
@@ -0,0 +1,67 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <chrono>
+#include "profiler.h"
+
+enum class PacingMode
+{
+	LIMITED, // the pacer waits until the next frame deadline
+	VSYNC, // the swap blocks on the display refresh, the pacer only measures
+	UNLIMITED // no waiting at all
+};
+
+// Paces the main loop to a target frame rate without burning a core: the wait is
+// done by sleeping until shortly before the deadline and yielding only for the
+// remaining fraction of a millisecond. The spin window adapts to how much the OS
+// oversleeps. Frame, work and wait times are kept to report jitter and how the
+// frame was spent.
+//
+// per frame: markWorkDone() when the CPU work of the frame is finished, then swap
+// the buffers, then wait(). Everything between the two calls counts as waiting.
+class FramePacer {
+public:
+	explicit FramePacer(float target_fps = 60.0f);
+	~FramePacer();
+	FramePacer(const FramePacer&) = delete;
+	FramePacer& operator=(const FramePacer&) = delete;
+
+	void setMode(PacingMode mode);
+	PacingMode getMode() const { return m_mode; }
+	// swap interval to pass to glfwSwapInterval for the current mode
+	int getSwapInterval() const { return m_mode == PacingMode::VSYNC ? 1 : 0; }
+	void setTargetFPS(float target_fps);
+	float getTargetFPS() const { return m_target_fps; }
+
+	void markWorkDone();
+	// waits for the next deadline in LIMITED mode and closes the frame
+	void wait();
+
+	// all times in milliseconds, one sample per frame
+	const ProfileSeries& getFrameTimes() const { return m_frame_times; }
+	const ProfileSeries& getWorkTimes() const { return m_work_times; }
+	const ProfileSeries& getSleepTimes() const { return m_sleep_times; } // waiting without using the CPU
+	const ProfileSeries& getSpinTimes() const { return m_spin_times; } // waiting on the CPU
+	// standard deviation of the stored frame times
+	float getJitter() const;
+	float getSpinThreshold() const { return m_spin_threshold.count() * 1000.0f; }
+
+private:
+	typedef std::chrono::steady_clock clock;
+	typedef std::chrono::duration<float> seconds;
+
+	PacingMode m_mode;
+	float m_target_fps;
+	clock::duration m_period;
+	clock::time_point m_deadline; // end of the current frame in LIMITED mode
+	clock::time_point m_frame_start;
+	clock::time_point m_work_done;
+	seconds m_spin_threshold; // sleep until this long before the deadline, then spin
+
+	ProfileSeries m_frame_times;
+	ProfileSeries m_work_times;
+	ProfileSeries m_sleep_times;
+	ProfileSeries m_spin_times;
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include "framebuffer.h"
+#include "render_state.h"
 #include<glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <iostream>
@@ -6,10 +7,10 @@
 
 void FrameBuffer::init(float width, float height) {
 	glGenFramebuffers(1, &FBO);
-	glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+	RenderState::bindFramebuffer(FBO);
 
 	glGenTextures(1, &texture_ID);
-	glBindTexture(GL_TEXTURE_2D, texture_ID);
+	RenderState::bindTexture(texture_ID);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -24,8 +25,8 @@ void FrameBuffer::init(float width, float height) {
 	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
 		std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!\n";
 
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	RenderState::bindFramebuffer(0);
+	RenderState::bindTexture(0);
 	glBindRenderbuffer(GL_RENDERBUFFER, 0);
 }
 
@@ -33,6 +34,8 @@ FrameBuffer::~FrameBuffer()
 {
 	glDeleteFramebuffers(1, &FBO);
 	glDeleteTextures(1, &texture_ID);
+	RenderState::forgetFramebuffer(FBO);
+	RenderState::forgetTexture(texture_ID);
 	glDeleteRenderbuffers(1, &RBO);
 }
 
@@ -43,7 +46,9 @@ unsigned int FrameBuffer::getFrameTexture()
 
 void FrameBuffer::rescaleFrameBuffer(float width, float height)
 {
-	glBindTexture(GL_TEXTURE_2D, texture_ID);
+	// the attachments are re-specified on the framebuffer, so it has to be bound
+	RenderState::bindFramebuffer(FBO);
+	RenderState::bindTexture(texture_ID);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -52,14 +57,15 @@ void FrameBuffer::rescaleFrameBuffer(float width, float height)
 	glBindRenderbuffer(GL_RENDERBUFFER, RBO);
 	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
 	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, RBO);
+	RenderState::bindFramebuffer(0);
 }
 
 void FrameBuffer::bind() const
 {
-	glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+	RenderState::bindFramebuffer(FBO);
 }
 
 void FrameBuffer::unbind() const
 {
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	RenderState::bindFramebuffer(0);
 }
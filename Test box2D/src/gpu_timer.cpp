@@ -0,0 +1,48 @@
+#include "gpu_timer.h"
+
+GpuTimer::~GpuTimer()
+{
+	if (m_queries[0] != 0)
+		glDeleteQueries(QUERY_COUNT, m_queries);
+}
+
+void GpuTimer::init()
+{
+	if (m_queries[0] == 0)
+		glGenQueries(QUERY_COUNT, m_queries);
+}
+
+void GpuTimer::begin()
+{
+	// all queries in flight: drop this sample rather than reusing an unread query
+	if (m_active || m_pending == QUERY_COUNT)
+		return;
+	glBeginQuery(GL_TIME_ELAPSED, m_queries[m_next]);
+	m_active = true;
+}
+
+void GpuTimer::end()
+{
+	if (!m_active)
+		return;
+	glEndQuery(GL_TIME_ELAPSED);
+	m_active = false;
+	m_next = (m_next + 1) % QUERY_COUNT;
+	m_pending++;
+}
+
+bool GpuTimer::getResult(float* milliseconds)
+{
+	if (m_pending == 0)
+		return false;
+	GLuint oldest = m_queries[(m_next + QUERY_COUNT - m_pending) % QUERY_COUNT];
+	GLint available = 0;
+	glGetQueryObjectiv(oldest, GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available)
+		return false;
+	GLuint64 nanoseconds = 0;
+	glGetQueryObjectui64v(oldest, GL_QUERY_RESULT, &nanoseconds);
+	m_pending--;
+	*milliseconds = static_cast<float>(nanoseconds) / 1.0e6f;
+	return true;
+}
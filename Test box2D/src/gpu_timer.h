@@ -0,0 +1,33 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <glad/glad.h>
+
+// Measures the GPU time of a section of GL commands with GL_TIME_ELAPSED queries.
+// Results arrive a few frames late, so a small ring of queries is used and the
+// oldest one is read back only once it is available: the CPU never waits for the GPU.
+// GL_TIME_ELAPSED queries can't be nested, only one timer may be active at a time.
+class GpuTimer {
+public:
+	static const unsigned int QUERY_COUNT = 4;
+
+	GpuTimer() {}
+	~GpuTimer();
+	GpuTimer(const GpuTimer&) = delete;
+	GpuTimer& operator=(const GpuTimer&) = delete;
+
+	// creates the query objects, needs a current GL context
+	void init();
+	void begin();
+	void end();
+	// reads back the oldest finished query, returns false if none is ready yet
+	bool getResult(float* milliseconds);
+
+private:
+	GLuint m_queries[QUERY_COUNT] = {};
+	unsigned int m_next = 0; // query used by the next begin()
+	unsigned int m_pending = 0; // queries ended and not read back yet
+	bool m_active = false;
+};
+
+#endif
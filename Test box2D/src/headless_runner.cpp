@@ -0,0 +1,338 @@
+// Headless simulation runner: loads a canva file, steps the Box2D world as fast as
+// possible and reports the throughput and the final state of the bodies. It only
+// links the Box2D-facing code (canvas, simulation manager), so it runs on machines
+// without a GPU or a windowing system.
+//
+// usage: headless_runner <canvas or state file> [-n steps] [--hz rate] [--scale render_scale] [--dump]
+//                        [--sweep gravity|restitution from to count] [--threads n] [--profile csv]
+//                        [--save-state file] [--workers n] [--check-replay] [--rays n]
+//
+// --sweep builds count copies of the scene with the parameter spread evenly over
+// [from, to] and steps them concurrently, one world per thread pool task.
+// --profile writes the b2Profile of every step to a CSV file.
+// --save-state writes the world state at the end of the run. A state file (also saved
+// by the editor at Play) can be passed instead of a canva to start from it; its time
+// step is used unless --hz is given.
+// --workers steps a single run on n threads (0: one per core), see
+// SimulationManager::setWorkerCount. Its results differ from those of one worker.
+// --check-replay runs the steps twice, restoring the state captured at the start in
+// between as Reset does, and fails if the two runs don't end in the same state. Reset
+// restores in place, which is not bit exact (see SimulationManager::restoreState), so
+// it reports the largest position difference as well.
+// --rays times batches of n ray casts and n box queries through the bodies at the end of
+// the run (SimulationManager::castRays/queryBoxes), on --threads query threads.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include "batch_query.h"
+#include "canvas.h"
+#include "scene_file.h"
+#include "simulation_manager.h"
+#include "thread_pool.h"
+#include "world_batch.h"
+
+// must match the RENDER_SCALE the canva was drawn with in the editor
+const float DEFAULT_RENDER_SCALE = 30.0f;
+
+void printUsage()
+{
+    std::cout << "usage: headless_runner <canvas or state file> [-n steps] [--hz rate] [--scale render_scale] [--dump]\n"
+        << "                       [--sweep gravity|restitution from to count] [--threads n] [--profile csv]\n"
+        << "                       [--save-state file] [--workers n] [--check-replay] [--rays n]" << std::endl;
+}
+
+// store index of the first body whose transform or velocities differ between the two
+// captures, -1 if they are bit for bit the same
+int findDivergence(const std::vector<BodyState>& a, const std::vector<BodyState>& b)
+{
+    if (a.size() != b.size())
+        return 0;
+    for (unsigned int i = 0; i < a.size(); i++)
+        if (a[i].handle != b[i].handle || a[i].position.x != b[i].position.x || a[i].position.y != b[i].position.y ||
+            a[i].angle != b[i].angle || a[i].linear_velocity.x != b[i].linear_velocity.x ||
+            a[i].linear_velocity.y != b[i].linear_velocity.y || a[i].angular_velocity != b[i].angular_velocity ||
+            a[i].awake != b[i].awake)
+            return static_cast<int>(i);
+    return -1;
+}
+
+// largest distance between the positions of the same body in the two captures, which
+// must hold the same bodies
+float maxPositionError(const std::vector<BodyState>& a, const std::vector<BodyState>& b)
+{
+    float error = 0.0f;
+    for (unsigned int i = 0; i < a.size() && i < b.size(); i++)
+        error = std::max(error, (a[i].position - b[i].position).Length());
+    return error;
+}
+
+void captureBodies(const BodyStore& bodies, std::vector<BodyState>& states)
+{
+    states.clear();
+    for (unsigned int i = 0; i < bodies.size(); i++)
+        states.push_back(WorldState::captureBody(bodies.handles[i], bodies.kinds[i], bodies.dimensions[i], bodies.colors[i], bodies.bodies[i]));
+}
+
+// times batches of ray casts and box queries spread over the area of the bodies
+void runQueryBenchmark(SimulationManager& simulation_manager, int count, unsigned int threads)
+{
+    const int BATCHES = 10;
+    const BodyStore& bodies = simulation_manager.m_bodies;
+    b2Vec2 lower(0.0f, 0.0f), upper(1.0f, 1.0f);
+    for (unsigned int i = 0; i < bodies.size(); i++)
+    {
+        const b2Vec2 position = bodies.bodies[i]->GetPosition();
+        lower = i == 0 ? position : b2Min(lower, position);
+        upper = i == 0 ? position : b2Max(upper, position);
+    }
+    std::mt19937 generator(1234);
+    std::uniform_real_distribution<float> x(lower.x, upper.x), y(lower.y, upper.y);
+    RayCastBatch ray_batch;
+    BoxQueryBatch box_batch;
+    for (int i = 0; i < count; i++)
+    {
+        ray_batch.add(b2Vec2(x(generator), y(generator)), b2Vec2(x(generator), y(generator)));
+        const b2Vec2 center(x(generator), y(generator));
+        b2AABB box;
+        box.lowerBound = center - b2Vec2(1.0f, 1.0f);
+        box.upperBound = center + b2Vec2(1.0f, 1.0f);
+        box_batch.add(box);
+    }
+
+    simulation_manager.setQueryThreadCount(threads);
+    // the first batches create the query pool and size the results
+    simulation_manager.castRays(ray_batch);
+    simulation_manager.queryBoxes(box_batch);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < BATCHES; i++)
+        simulation_manager.castRays(ray_batch);
+    auto middle = std::chrono::steady_clock::now();
+    for (int i = 0; i < BATCHES; i++)
+        simulation_manager.queryBoxes(box_batch);
+    auto end = std::chrono::steady_clock::now();
+
+    int ray_hits = 0;
+    for (BodyHandle handle : ray_batch.handles)
+        if (handle != INVALID_BODY_HANDLE)
+            ray_hits++;
+    std::cout << "ray casts:      " << count << " per batch, " << std::chrono::duration<double, std::milli>(middle - start).count() / BATCHES
+        << " ms per batch, " << ray_hits << " hits\n"
+        << "box queries:    " << count << " per batch, " << std::chrono::duration<double, std::milli>(end - middle).count() / BATCHES
+        << " ms per batch, " << box_batch.hits.size() << " hits" << std::endl;
+}
+
+// steps one world per sweep value concurrently and prints a line per world
+int runSweep(const CanvasShapes& shapes, const std::string& parameter, float from, float to, int count,
+    int steps, float rate, float render_scale, unsigned int threads)
+{
+    ThreadPool pool(threads);
+    WorldBatch batch(pool, render_scale);
+    for (int i = 0; i < count; i++)
+    {
+        float value = count > 1 ? from + (to - from) * i / (count - 1) : from;
+        WorldConfig config;
+        config.time_step = 1.0f / rate;
+        if (parameter == "gravity")
+            config.gravity = b2Vec2(0.0f, value);
+        else
+            config.restitution = value;
+        batch.addWorld(shapes, config);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    batch.run(steps);
+    auto end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(end - start).count();
+
+    std::cout << "worlds:         " << count << " on " << pool.getThreadCount() << " threads\n"
+        << "steps:          " << steps << " per world at " << rate << " Hz\n"
+        << "wall time:      " << seconds << " s\n"
+        << "steps/sec:      " << (seconds > 0.0 ? double(steps) * count / seconds : 0.0) << " (all worlds)\n";
+    // one world per line: parameter value, awake bodies, center of mass of the dynamic bodies, kinetic energy
+    std::cout << parameter << " awake com_x com_y kinetic_energy" << "\n";
+    for (int i = 0; i < batch.size(); i++)
+    {
+        const WorldConfig& config = batch.getConfig(i);
+        const WorldResult& result = batch.getResult(i);
+        std::cout << (parameter == "gravity" ? config.gravity.y : config.restitution) << " " << result.awake_bodies << " "
+            << result.center_of_mass.x << " " << result.center_of_mass.y << " " << result.kinetic_energy << "\n";
+    }
+    std::cout << std::flush;
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        printUsage();
+        return 1;
+    }
+
+    std::string canvas_file = argv[1];
+    int steps = 1000;
+    float rate = 60.0f;
+    bool rate_given = false;
+    float render_scale = DEFAULT_RENDER_SCALE;
+    bool dump = false;
+    std::string sweep_parameter;
+    float sweep_from = 0.0f, sweep_to = 0.0f;
+    int sweep_count = 0;
+    unsigned int threads = 0;
+    unsigned int workers = 1;
+    std::string profile_file;
+    std::string state_file;
+    bool check_replay = false;
+    int rays = 0;
+    for (int i = 2; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            steps = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--hz") == 0 && i + 1 < argc)
+        {
+            rate = static_cast<float>(std::atof(argv[++i]));
+            rate_given = true;
+        }
+        else if (std::strcmp(argv[i], "--scale") == 0 && i + 1 < argc)
+            render_scale = static_cast<float>(std::atof(argv[++i]));
+        else if (std::strcmp(argv[i], "--dump") == 0)
+            dump = true;
+        else if (std::strcmp(argv[i], "--sweep") == 0 && i + 4 < argc)
+        {
+            sweep_parameter = argv[++i];
+            sweep_from = static_cast<float>(std::atof(argv[++i]));
+            sweep_to = static_cast<float>(std::atof(argv[++i]));
+            sweep_count = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            threads = static_cast<unsigned int>(std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--profile") == 0 && i + 1 < argc)
+            profile_file = argv[++i];
+        else if (std::strcmp(argv[i], "--save-state") == 0 && i + 1 < argc)
+            state_file = argv[++i];
+        else if (std::strcmp(argv[i], "--workers") == 0 && i + 1 < argc)
+            workers = static_cast<unsigned int>(std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--check-replay") == 0)
+            check_replay = true;
+        else if (std::strcmp(argv[i], "--rays") == 0 && i + 1 < argc)
+            rays = std::atoi(argv[++i]);
+        else
+        {
+            printUsage();
+            return 1;
+        }
+    }
+    bool sweep = !sweep_parameter.empty();
+    bool from_state = isWorldStateFile(canvas_file);
+    if (steps <= 0 || rate <= 0.0f || render_scale <= 0.0f || rays < 0 ||
+        (sweep && ((sweep_parameter != "gravity" && sweep_parameter != "restitution") || sweep_count <= 0 || from_state)))
+    {
+        printUsage();
+        return 1;
+    }
+
+    SimulationManager simulation_manager(render_scale, 0, 0);
+    if (from_state)
+    {
+        if (!simulation_manager.loadState(canvas_file))
+        {
+            std::cout << "ERROR::HEADLESS: Failed to read state file " << canvas_file << std::endl;
+            return 1;
+        }
+        if (rate_given)
+            simulation_manager.setTimeStep(1.0f / rate);
+        else
+            rate = 1.0f / simulation_manager.getTimeStep();
+    }
+    else
+    {
+        CanvasShapes shapes;
+        if (!loadScene(canvas_file, &shapes))
+        {
+            std::cout << "ERROR::HEADLESS: Failed to open canvas file " << canvas_file << std::endl;
+            return 1;
+        }
+        if (sweep)
+            return runSweep(shapes, sweep_parameter, sweep_from, sweep_to, sweep_count, steps, rate, render_scale, threads);
+        simulation_manager.setTimeStep(1.0f / rate);
+        createCanvasObjects(simulation_manager, shapes);
+    }
+
+    simulation_manager.setWorkerCount(workers);
+    if (check_replay)
+    {
+        simulation_manager.captureState();
+        for (int i = 0; i < steps; i++)
+            simulation_manager.step();
+        std::vector<BodyState> first_run, second_run;
+        captureBodies(simulation_manager.m_bodies, first_run);
+        simulation_manager.restoreState();
+        for (int i = 0; i < steps; i++)
+            simulation_manager.step();
+        captureBodies(simulation_manager.m_bodies, second_run);
+        const int divergence = findDivergence(first_run, second_run);
+        if (divergence >= 0)
+        {
+            std::cout << "replay:         differs from body " << divergence << " of " << first_run.size()
+                << ", max position error " << maxPositionError(first_run, second_run) << " m" << std::endl;
+            return 1;
+        }
+        std::cout << "replay:         identical (" << first_run.size() << " bodies)" << std::endl;
+        simulation_manager.restoreState();
+    }
+
+    // one profiler row per step, sized to keep the whole run
+    Profiler profiler(profile_file.empty() ? 1 : steps);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < steps; i++)
+    {
+        profiler.beginFrame();
+        simulation_manager.step();
+        simulation_manager.collectProfile(profiler);
+        profiler.endFrame();
+    }
+    auto end = std::chrono::steady_clock::now();
+    if (!state_file.empty())
+    {
+        simulation_manager.captureState();
+        if (!simulation_manager.saveState(state_file))
+            std::cout << "ERROR::HEADLESS: Failed to write state " << state_file << std::endl;
+    }
+    if (!profile_file.empty() && !profiler.writeCSV(profile_file))
+        std::cout << "ERROR::HEADLESS: Failed to write profile " << profile_file << std::endl;
+    double seconds = std::chrono::duration<double>(end - start).count();
+
+    // the store, as the bodies may be spread over several worlds
+    const BodyStore& bodies = simulation_manager.m_bodies;
+    int awake = 0;
+    for (unsigned int i = 0; i < bodies.size(); i++)
+        if (bodies.bodies[i]->IsAwake())
+            awake++;
+
+    std::cout << "bodies:         " << bodies.size() << " (" << awake << " awake)\n"
+        << "workers:        " << simulation_manager.getWorkerCount() << "\n"
+        << "steps:          " << steps << " at " << rate << " Hz (" << steps / rate << " s simulated)\n"
+        << "wall time:      " << seconds << " s\n"
+        << "steps/sec:      " << (seconds > 0.0 ? steps / seconds : 0.0) << std::endl;
+
+    if (rays > 0)
+        runQueryBenchmark(simulation_manager, rays, threads);
+
+    if (dump)
+    {
+        // final state, one body per line: kind, position, angle, linear velocity
+        for (unsigned int i = 0; i < bodies.size(); i++)
+        {
+            const b2Body* body = bodies.bodies[i];
+            std::cout << getBodyKindName(bodies.kinds[i]) << " " << body->GetPosition().x << " " << body->GetPosition().y << " "
+                << body->GetAngle() << " " << body->GetLinearVelocity().x << " " << body->GetLinearVelocity().y << "\n";
+        }
+    }
+    return 0;
+}
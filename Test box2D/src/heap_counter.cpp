@@ -0,0 +1,82 @@
+#include "heap_counter.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+	// plain thread_local integers need no dynamic initialization, so they can be used
+	// from operator new at any time, including during static initialization
+	thread_local unsigned long long allocations = 0;
+	thread_local unsigned long long allocated_bytes = 0;
+
+	void* allocate(std::size_t size)
+	{
+		allocations++;
+		allocated_bytes += size;
+		return std::malloc(size == 0 ? 1 : size);
+	}
+}
+
+unsigned long long HeapCounter::getAllocations()
+{
+	return allocations;
+}
+
+unsigned long long HeapCounter::getAllocatedBytes()
+{
+	return allocated_bytes;
+}
+
+void* operator new(std::size_t size)
+{
+	void* block = allocate(size);
+	if (block == nullptr)
+		throw std::bad_alloc();
+	return block;
+}
+
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	return allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	return allocate(size);
+}
+
+void operator delete(void* block) noexcept
+{
+	std::free(block);
+}
+
+void operator delete[](void* block) noexcept
+{
+	std::free(block);
+}
+
+void operator delete(void* block, std::size_t) noexcept
+{
+	std::free(block);
+}
+
+void operator delete[](void* block, std::size_t) noexcept
+{
+	std::free(block);
+}
+
+void operator delete(void* block, const std::nothrow_t&) noexcept
+{
+	std::free(block);
+}
+
+void operator delete[](void* block, const std::nothrow_t&) noexcept
+{
+	std::free(block);
+}
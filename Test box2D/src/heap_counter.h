@@ -0,0 +1,18 @@
+#ifndef HEAP_COUNTER_H
+#define HEAP_COUNTER_H
+
+// Counts the heap allocations made through the global operator new, per thread, to
+// check that the steady-state frame of the editor does not allocate. heap_counter.cpp
+// replaces the global operator new and delete, so the counts only move in the programs
+// it is linked in. malloc and the allocators of the libraries (e.g. ImGui) are not seen.
+class HeapCounter {
+public:
+	// operator new calls made by the calling thread since it started
+	static unsigned long long getAllocations();
+	static unsigned long long getAllocatedBytes();
+private:
+	// private constructor, all the state is static like in ResourceManager
+	HeapCounter() {}
+};
+
+#endif
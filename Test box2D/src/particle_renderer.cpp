@@ -0,0 +1,80 @@
+#include "particle_renderer.h"
+#include "render_state.h"
+
+#include <algorithm>
+
+ParticleRenderer::ParticleRenderer(Shader& shader, unsigned int capacity)
+{
+	this->shader = &shader;
+	this->capacity = capacity;
+
+	float vertices[] = {
+		// pos	    // tex
+		0.0f, 0.0f, 0.0f, 0.0f,
+		0.0f, 1.0f, 0.0f, 1.0f,
+		1.0f, 0.0f, 1.0f, 0.0f,
+		1.0f, 1.0f, 1.0f, 1.0f
+	};
+	glGenVertexArrays(1, &quad_VAO);
+	glGenBuffers(1, &quad_VBO);
+	glGenBuffers(1, &instance_VBO);
+
+	RenderState::bindVertexArray(quad_VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, quad_VBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+
+	// instance buffer sections, capacity values each: x, y, size, alpha, color
+	const size_t section = capacity * sizeof(float);
+	glBindBuffer(GL_ARRAY_BUFFER, instance_VBO);
+	glBufferData(GL_ARRAY_BUFFER, 5 * section, nullptr, GL_STREAM_DRAW);
+	for (unsigned int attribute = 1; attribute <= 4; attribute++)
+	{
+		glEnableVertexAttribArray(attribute);
+		glVertexAttribPointer(attribute, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)((attribute - 1) * section));
+		glVertexAttribDivisor(attribute, 1);
+	}
+	glEnableVertexAttribArray(5);
+	glVertexAttribPointer(5, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(unsigned int), (void*)(4 * section));
+	glVertexAttribDivisor(5, 1);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	RenderState::bindVertexArray(0);
+}
+
+ParticleRenderer::~ParticleRenderer()
+{
+	glDeleteVertexArrays(1, &quad_VAO);
+	glDeleteBuffers(1, &quad_VBO);
+	glDeleteBuffers(1, &instance_VBO);
+	RenderState::forgetVertexArray(quad_VAO);
+}
+
+void ParticleRenderer::draw(const ParticleSystem& particles, const Texture2D& texture)
+{
+	const unsigned int count = std::min(particles.getCount(), capacity);
+	if (count == 0)
+		return;
+
+	// orphan the buffer so that the driver does not wait for the previous frame's draw
+	const size_t section = capacity * sizeof(float);
+	glBindBuffer(GL_ARRAY_BUFFER, instance_VBO);
+	glBufferData(GL_ARRAY_BUFFER, 5 * section, nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(float), particles.positions_x.data());
+	glBufferSubData(GL_ARRAY_BUFFER, section, count * sizeof(float), particles.positions_y.data());
+	glBufferSubData(GL_ARRAY_BUFFER, 2 * section, count * sizeof(float), particles.sizes.data());
+	glBufferSubData(GL_ARRAY_BUFFER, 3 * section, count * sizeof(float), particles.alphas.data());
+	glBufferSubData(GL_ARRAY_BUFFER, 4 * section, count * sizeof(unsigned int), particles.colors.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	shader->use();
+	RenderState::activeTexture(0);
+	texture.bind();
+	RenderState::bindVertexArray(quad_VAO);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+	glDisable(GL_BLEND);
+	RenderState::bindVertexArray(0);
+}
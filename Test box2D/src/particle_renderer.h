@@ -0,0 +1,25 @@
+#ifndef PARTICLE_RENDERER_H
+#define PARTICLE_RENDERER_H
+
+#include "particle_system.h"
+#include "shader.hpp"
+#include "texture.h"
+
+// Draws the particles of a ParticleSystem with one instanced draw call. The arrays of
+// the system are uploaded as they are, one section of the instance buffer per array,
+// so there is no interleaving pass on the CPU. The particles are blended additively.
+// Like SpriteRenderer, it keeps a pointer to the shader, which must outlive it
+class ParticleRenderer {
+public:
+	// capacity: of the particle systems that will be drawn
+	ParticleRenderer(Shader& shader, unsigned int capacity);
+	~ParticleRenderer();
+
+	void draw(const ParticleSystem& particles, const Texture2D& texture);
+private:
+	Shader* shader;
+	unsigned int capacity;
+	unsigned int quad_VAO, quad_VBO, instance_VBO;
+};
+
+#endif
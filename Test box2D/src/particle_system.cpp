@@ -0,0 +1,263 @@
+#include "particle_system.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PARTICLES_SSE2
+#endif
+
+namespace
+{
+	unsigned int packColor(const glm::vec3& color)
+	{
+		glm::vec3 c = glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f;
+		return static_cast<unsigned int>(c.r) | static_cast<unsigned int>(c.g) << 8 | static_cast<unsigned int>(c.b) << 16 | 0xff000000u;
+	}
+
+	// finds the first collider containing the particle
+	class ColliderQueryCallback {
+	public:
+		ColliderQueryCallback(const b2DynamicTree& tree, const b2Vec2& point) : hit(-1), m_tree(tree), m_point(point) {}
+		int hit;
+		bool QueryCallback(int32 proxy_id)
+		{
+			const b2Shape* shape = static_cast<const b2Shape*>(m_tree.GetUserData(proxy_id));
+			b2Transform identity;
+			identity.SetIdentity();
+			if (!shape->TestPoint(identity, m_point))
+				return true;
+			hit = proxy_id;
+			return false;
+		}
+	private:
+		const b2DynamicTree& m_tree;
+		b2Vec2 m_point;
+	};
+}
+
+ParticleSystem::ParticleSystem(unsigned int capacity)
+{
+	// room for the last group of 4 integrated together
+	this->capacity = capacity;
+	const unsigned int padded = (capacity + 3) & ~3u;
+	positions_x.resize(padded, 0.0f);
+	positions_y.resize(padded, 0.0f);
+	velocities_x.resize(padded, 0.0f);
+	velocities_y.resize(padded, 0.0f);
+	ages.resize(padded, 0.0f);
+	inverse_lifetimes.resize(padded, 0.0f);
+	alphas.resize(padded, 0.0f);
+	sizes.resize(padded, 0.0f);
+	colors.resize(padded, 0);
+	count = 0;
+	collider_bounds.lowerBound.SetZero();
+	collider_bounds.upperBound.SetZero();
+}
+
+unsigned int ParticleSystem::emit(const glm::vec2& position, unsigned int count, const ParticleParams& params)
+{
+	count = std::min(count, capacity - this->count);
+	const unsigned int color = packColor(params.color);
+	for (unsigned int n = 0; n < count; n++)
+	{
+		const unsigned int i = this->count++;
+		positions_x[i] = position.x;
+		positions_y[i] = position.y;
+		velocities_x[i] = params.velocity.x + params.spread * unit(random);
+		velocities_y[i] = params.velocity.y + params.spread * unit(random);
+		ages[i] = 0.0f;
+		inverse_lifetimes[i] = 1.0f / std::max(params.lifetime + params.lifetime_jitter * unit(random), 0.01f);
+		alphas[i] = 1.0f;
+		sizes[i] = params.size;
+		colors[i] = color;
+	}
+	return count;
+}
+
+int ParticleSystem::createEmitter(const glm::vec2& position, float rate, const ParticleParams& params)
+{
+	for (int i = 0; i < static_cast<int>(MAX_EMITTERS); i++)
+	{
+		if (emitters[i].active)
+			continue;
+		emitters[i] = ParticleEmitter();
+		emitters[i].position = position;
+		emitters[i].rate = rate;
+		emitters[i].params = params;
+		emitters[i].active = true;
+		return i;
+	}
+	return -1;
+}
+
+void ParticleSystem::destroyEmitter(int emitter)
+{
+	if (emitter >= 0 && emitter < static_cast<int>(MAX_EMITTERS))
+		emitters[emitter].active = false;
+}
+
+void ParticleSystem::update(float dt)
+{
+	if (dt <= 0.0f)
+		return;
+	for (ParticleEmitter& emitter : emitters)
+	{
+		if (!emitter.active)
+			continue;
+		emitter.pending += emitter.rate * dt;
+		const unsigned int spawned = static_cast<unsigned int>(emitter.pending);
+		emitter.pending -= spawned;
+		emit(emitter.position, spawned, emitter.params);
+	}
+	integrate(dt);
+	if (collisions && !colliders.empty())
+		collide(dt);
+	removeDead();
+}
+
+void ParticleSystem::integrate(float dt)
+{
+	const float damping = std::max(1.0f - drag * dt, 0.0f);
+	unsigned int i = 0;
+#ifdef PARTICLES_SSE2
+	const __m128 dt4 = _mm_set1_ps(dt);
+	const __m128 gravity_x = _mm_set1_ps(gravity.x * dt);
+	const __m128 gravity_y = _mm_set1_ps(gravity.y * dt);
+	const __m128 damping4 = _mm_set1_ps(damping);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 zero = _mm_setzero_ps();
+	// the lanes past count belong to dead or unused slots, computing them is harmless
+	for (; i < count; i += 4)
+	{
+		__m128 vx = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(&velocities_x[i]), gravity_x), damping4);
+		__m128 vy = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(&velocities_y[i]), gravity_y), damping4);
+		_mm_storeu_ps(&velocities_x[i], vx);
+		_mm_storeu_ps(&velocities_y[i], vy);
+		_mm_storeu_ps(&positions_x[i], _mm_add_ps(_mm_loadu_ps(&positions_x[i]), _mm_mul_ps(vx, dt4)));
+		_mm_storeu_ps(&positions_y[i], _mm_add_ps(_mm_loadu_ps(&positions_y[i]), _mm_mul_ps(vy, dt4)));
+		__m128 age = _mm_add_ps(_mm_loadu_ps(&ages[i]), dt4);
+		_mm_storeu_ps(&ages[i], age);
+		__m128 alpha = _mm_sub_ps(one, _mm_mul_ps(age, _mm_loadu_ps(&inverse_lifetimes[i])));
+		_mm_storeu_ps(&alphas[i], _mm_max_ps(alpha, zero));
+	}
+#endif
+	for (; i < count; i++)
+	{
+		velocities_x[i] = (velocities_x[i] + gravity.x * dt) * damping;
+		velocities_y[i] = (velocities_y[i] + gravity.y * dt) * damping;
+		positions_x[i] += velocities_x[i] * dt;
+		positions_y[i] += velocities_y[i] * dt;
+		ages[i] += dt;
+		alphas[i] = std::max(1.0f - ages[i] * inverse_lifetimes[i], 0.0f);
+	}
+}
+
+void ParticleSystem::collide(float dt)
+{
+	b2Transform identity;
+	identity.SetIdentity();
+	for (unsigned int i = 0; i < count; i++)
+	{
+		const b2Vec2 position(positions_x[i], positions_y[i]);
+		if (position.x < collider_bounds.lowerBound.x || position.y < collider_bounds.lowerBound.y ||
+			position.x > collider_bounds.upperBound.x || position.y > collider_bounds.upperBound.y)
+			continue;
+		ColliderQueryCallback callback(collider_tree, position);
+		b2AABB point_box;
+		point_box.lowerBound = point_box.upperBound = position;
+		collider_tree.Query(&callback, point_box);
+		if (callback.hit < 0)
+			continue;
+
+		// the particle went in during this update: move it back to where its path
+		// crossed the surface, and reflect its velocity
+		const b2Shape* shape = static_cast<const b2Shape*>(collider_tree.GetUserData(callback.hit));
+		b2Vec2 velocity(velocities_x[i], velocities_y[i]);
+		b2RayCastInput input;
+		input.p1 = position - dt * velocity;
+		input.p2 = position;
+		input.maxFraction = 1.0f;
+		b2RayCastOutput output;
+		if (velocity.LengthSquared() == 0.0f || !shape->RayCast(&output, input, identity, 0))
+		{
+			// it started inside, e.g. spawned in a wall: just stop it
+			velocities_x[i] = velocities_y[i] = 0.0f;
+			continue;
+		}
+		const b2Vec2 contact = input.p1 + output.fraction * (input.p2 - input.p1) + b2_linearSlop * output.normal;
+		const float normal_speed = b2Dot(velocity, output.normal);
+		const b2Vec2 tangent_velocity = velocity - normal_speed * output.normal;
+		velocity = (1.0f - friction) * tangent_velocity - restitution * normal_speed * output.normal;
+		positions_x[i] = contact.x;
+		positions_y[i] = contact.y;
+		velocities_x[i] = velocity.x;
+		velocities_y[i] = velocity.y;
+	}
+}
+
+void ParticleSystem::removeDead()
+{
+	for (unsigned int i = 0; i < count;)
+	{
+		if (alphas[i] > 0.0f)
+		{
+			i++;
+			continue;
+		}
+		const unsigned int last = --count;
+		positions_x[i] = positions_x[last];
+		positions_y[i] = positions_y[last];
+		velocities_x[i] = velocities_x[last];
+		velocities_y[i] = velocities_y[last];
+		ages[i] = ages[last];
+		inverse_lifetimes[i] = inverse_lifetimes[last];
+		alphas[i] = alphas[last];
+		sizes[i] = sizes[last];
+		colors[i] = colors[last];
+	}
+}
+
+void ParticleSystem::setColliders(const std::vector<BodyState>& bodies)
+{
+	clearColliders();
+	for (const BodyState& body : bodies)
+	{
+		if (body.type != b2_staticBody)
+			continue;
+		Collider collider;
+		collider.is_circle = body.kind == BodyKind::BALL;
+		if (collider.is_circle)
+		{
+			collider.circle.m_p = body.position;
+			collider.circle.m_radius = body.dimensions.x / 2;
+		}
+		else
+			collider.polygon.SetAsBox(body.dimensions.x / 2, body.dimensions.y / 2, body.position, body.angle);
+		colliders.push_back(collider);
+	}
+	// the proxies point to the shapes, so they are added once the vector is complete
+	b2Transform identity;
+	identity.SetIdentity();
+	for (unsigned int i = 0; i < colliders.size(); i++)
+	{
+		const b2Shape& shape = colliders[i].getShape();
+		b2AABB box;
+		shape.ComputeAABB(&box, identity, 0);
+		collider_proxies.push_back(collider_tree.CreateProxy(box, const_cast<b2Shape*>(&shape)));
+		if (i == 0)
+			collider_bounds = box;
+		else
+			collider_bounds.Combine(box);
+	}
+}
+
+void ParticleSystem::clearColliders()
+{
+	for (int proxy : collider_proxies)
+		collider_tree.DestroyProxy(proxy);
+	collider_proxies.clear();
+	colliders.clear();
+	collider_bounds.lowerBound.SetZero();
+	collider_bounds.upperBound.SetZero();
+}
@@ -0,0 +1,105 @@
+#ifndef PARTICLE_SYSTEM_H
+#define PARTICLE_SYSTEM_H
+
+#include <box2d/box2d.h>
+#include <glm/glm.hpp>
+#include <random>
+#include <vector>
+#include "world_state.h"
+
+// spawn parameters of a burst, or of the particles of an emitter. Box2D units and seconds
+struct ParticleParams
+{
+	glm::vec2 velocity = glm::vec2(0.0f, -3.0f); // mean initial velocity
+	float spread = 3.0f; // up to this much is added at random to each velocity axis
+	float lifetime = 1.5f;
+	float lifetime_jitter = 0.5f; // up to this much is added or removed at random
+	float size = 0.15f;
+	glm::vec3 color = glm::vec3(1.0f);
+};
+
+// continuous source of particles, see ParticleSystem::createEmitter
+struct ParticleEmitter
+{
+	glm::vec2 position = glm::vec2(0.0f);
+	float rate = 1000.0f; // particles per second
+	ParticleParams params;
+	bool active = false; // slot in use
+	float pending = 0.0f; // fraction of a particle carried over to the next update
+};
+
+// Purely visual particles (debris, sparks...) simulated on the CPU, next to the Box2D
+// world instead of inside it. The particles live in fixed-capacity structure-of-arrays
+// storage: [0, getCount()) are alive, and a dead particle is replaced by the last one.
+// The arrays are padded to a multiple of 4 so that update() integrates 4 particles at
+// a time with SSE2, and they are uploaded to the GPU as they are by ParticleRenderer.
+// Particles may bounce on a copy of the static bodies of the world, see setColliders.
+class ParticleSystem {
+public:
+	static const unsigned int MAX_EMITTERS = 32;
+
+	std::vector<float> positions_x, positions_y;
+	std::vector<float> velocities_x, velocities_y;
+	std::vector<float> ages;
+	std::vector<float> inverse_lifetimes;
+	std::vector<float> alphas; // 1 at spawn, fades to 0 at the end of the lifetime
+	std::vector<float> sizes;
+	std::vector<unsigned int> colors; // RGBA8, the alpha byte is unused
+
+	glm::vec2 gravity = glm::vec2(0.0f, 10.0f);
+	float drag = 0.5f; // fraction of the velocity lost per second
+	// bounce on the colliders. Costs a broadphase query per particle near them
+	bool collisions = true;
+	float restitution = 0.4f;
+	float friction = 0.3f; // fraction of the tangential velocity lost at a bounce
+
+	explicit ParticleSystem(unsigned int capacity = 131072);
+	ParticleSystem(const ParticleSystem&) = delete;
+	ParticleSystem& operator=(const ParticleSystem&) = delete;
+
+	unsigned int getCount() const { return count; }
+	unsigned int getCapacity() const { return capacity; }
+	// spawns up to count particles at position, as many as there is room for. Returns
+	// the number of particles spawned
+	unsigned int emit(const glm::vec2& position, unsigned int count, const ParticleParams& params);
+	// takes a free emitter slot, returns -1 if all MAX_EMITTERS are in use
+	int createEmitter(const glm::vec2& position, float rate, const ParticleParams& params);
+	void destroyEmitter(int emitter);
+	ParticleEmitter& getEmitter(int emitter) { return emitters[emitter]; }
+	// runs the emitters, then moves and ages the particles and removes the dead ones
+	void update(float dt);
+	// removes every particle, the emitters are kept
+	void clear() { count = 0; }
+
+	// replaces the colliders by the static bodies among the given ones, e.g. from
+	// SimulationManager::getStaticBodies. They are a copy: they must be set again
+	// after the static bodies of the world change
+	void setColliders(const std::vector<BodyState>& bodies);
+	void clearColliders();
+private:
+	// world-space shape of a static body
+	struct Collider {
+		b2PolygonShape polygon;
+		b2CircleShape circle;
+		bool is_circle;
+		const b2Shape& getShape() const { return is_circle ? static_cast<const b2Shape&>(circle) : polygon; }
+	};
+
+	unsigned int capacity;
+	unsigned int count;
+	ParticleEmitter emitters[MAX_EMITTERS];
+	std::mt19937 random;
+	std::uniform_real_distribution<float> unit{ -1.0f, 1.0f };
+
+	std::vector<Collider> colliders;
+	std::vector<int> collider_proxies;
+	b2DynamicTree collider_tree;
+	b2AABB collider_bounds;
+
+	void integrate(float dt);
+	void collide(float dt);
+	// moves the last particle into the slot of a dead one
+	void removeDead();
+};
+
+#endif
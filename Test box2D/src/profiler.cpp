@@ -0,0 +1,140 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+ProfileSeries::ProfileSeries(unsigned int capacity)
+    : m_values(capacity > 0 ? capacity : 1, 0.0f), m_next(0), m_count(0), m_sorted(m_values.size())
+{
+}
+
+void ProfileSeries::push(float value)
+{
+    m_values[m_next] = value;
+    m_next = (m_next + 1) % capacity();
+    if (m_count < capacity())
+        m_count++;
+}
+
+void ProfileSeries::clear()
+{
+    std::fill(m_values.begin(), m_values.end(), 0.0f);
+    m_next = 0;
+    m_count = 0;
+}
+
+float ProfileSeries::at(unsigned int i) const
+{
+    unsigned int oldest = m_count < capacity() ? 0 : m_next;
+    return m_values[(oldest + i) % capacity()];
+}
+
+float ProfileSeries::min() const
+{
+    if (m_count == 0)
+        return 0.0f;
+    return *std::min_element(m_values.begin(), m_values.begin() + m_count);
+}
+
+float ProfileSeries::max() const
+{
+    if (m_count == 0)
+        return 0.0f;
+    return *std::max_element(m_values.begin(), m_values.begin() + m_count);
+}
+
+float ProfileSeries::average() const
+{
+    if (m_count == 0)
+        return 0.0f;
+    float sum = 0.0f;
+    for (unsigned int i = 0; i < m_count; i++)
+        sum += m_values[i];
+    return sum / m_count;
+}
+
+float ProfileSeries::percentile99() const
+{
+    if (m_count == 0)
+        return 0.0f;
+    // the order of the samples does not matter here, so the first m_count slots are
+    // the stored samples whether the ring has wrapped or not
+    std::copy(m_values.begin(), m_values.begin() + m_count, m_sorted.begin());
+    size_t rank = static_cast<size_t>(std::ceil(0.99f * (m_count - 1)));
+    std::nth_element(m_sorted.begin(), m_sorted.begin() + rank, m_sorted.begin() + m_count);
+    return m_sorted[rank];
+}
+
+Profiler::Profiler(unsigned int capacity)
+    : m_series(CHANNEL_COUNT, ProfileSeries(capacity)), m_step_counts(capacity), m_current_steps(0)
+{
+    std::fill(m_current, m_current + CHANNEL_COUNT, 0.0f);
+}
+
+const char* Profiler::getChannelName(Channel channel)
+{
+    static const char* names[CHANNEL_COUNT] = {
+        "step", "collide", "solve", "solve_init", "broadphase", "solve_toi",
+        "canvas", "scene", "particles", "imgui_render", "frame", "gpu_scene"
+    };
+    return channel < CHANNEL_COUNT ? names[channel] : "unknown";
+}
+
+void Profiler::beginFrame()
+{
+    std::fill(m_current, m_current + CHANNEL_COUNT, 0.0f);
+    m_current_steps = 0;
+}
+
+void Profiler::endFrame()
+{
+    if (paused)
+        return;
+    for (int channel = 0; channel < CHANNEL_COUNT; channel++)
+        m_series[channel].push(m_current[channel]);
+    m_step_counts.push(static_cast<float>(m_current_steps));
+}
+
+void Profiler::record(Channel channel, float milliseconds)
+{
+    m_current[channel] += milliseconds;
+}
+
+void Profiler::addStep(const b2Profile& profile, unsigned int steps)
+{
+    m_current[STEP] += profile.step;
+    m_current[COLLIDE] += profile.collide;
+    m_current[SOLVE] += profile.solve;
+    m_current[SOLVE_INIT] += profile.solveInit;
+    m_current[BROADPHASE] += profile.broadphase;
+    m_current[SOLVE_TOI] += profile.solveTOI;
+    m_current_steps += steps;
+}
+
+void Profiler::clear()
+{
+    for (auto& series : m_series)
+        series.clear();
+    m_step_counts.clear();
+}
+
+bool Profiler::writeCSV(const std::string& filePath) const
+{
+    std::ofstream outfile(filePath, std::ios_base::out | std::ios_base::trunc);
+    if (!outfile.is_open())
+        return false;
+
+    outfile << "frame,steps";
+    for (int channel = 0; channel < CHANNEL_COUNT; channel++)
+        outfile << "," << getChannelName(static_cast<Channel>(channel)) << "_ms";
+    outfile << "\n";
+    for (unsigned int i = 0; i < m_step_counts.size(); i++)
+    {
+        outfile << i << "," << m_step_counts.at(i);
+        for (int channel = 0; channel < CHANNEL_COUNT; channel++)
+            outfile << "," << m_series[channel].at(i);
+        outfile << "\n";
+    }
+    return static_cast<bool>(outfile);
+}
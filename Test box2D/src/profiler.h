@@ -0,0 +1,115 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <box2d/box2d.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Fixed-capacity ring buffer of samples (milliseconds). Once full, the oldest
+// sample is overwritten, so the memory used does not grow with the run time.
+class ProfileSeries {
+public:
+	explicit ProfileSeries(unsigned int capacity = 600);
+
+	void push(float value);
+	void clear();
+	unsigned int size() const { return m_count; }
+	unsigned int capacity() const { return static_cast<unsigned int>(m_values.size()); }
+	// i-th sample, 0 being the oldest one still stored
+	float at(unsigned int i) const;
+	float last() const { return m_count > 0 ? at(m_count - 1) : 0.0f; }
+	float min() const;
+	float max() const;
+	float average() const;
+	// value below which 99% of the stored samples lie
+	float percentile99() const;
+
+	// raw storage for ImGui::PlotLines(values, count, offset)
+	const float* data() const { return m_values.data(); }
+	int plotOffset() const { return m_count < capacity() ? 0 : static_cast<int>(m_next); }
+
+private:
+	std::vector<float> m_values;
+	unsigned int m_next;
+	unsigned int m_count;
+	mutable std::vector<float> m_sorted; // scratch for percentile99, sized once
+};
+
+// Per-frame timings: the Box2D profile of the steps taken during the frame (summed,
+// as the number of steps varies from frame to frame), CPU times of the main
+// phases of the frame and the GPU time of the scene pass.
+class Profiler {
+public:
+	enum Channel {
+		// b2Profile, summed over the steps of the frame
+		STEP,
+		COLLIDE,
+		SOLVE,
+		SOLVE_INIT,
+		BROADPHASE,
+		SOLVE_TOI,
+		// CPU
+		CANVAS,
+		SCENE,
+		PARTICLES, // part of SCENE
+		IMGUI_RENDER,
+		FRAME,
+		// GPU
+		GPU_SCENE,
+		CHANNEL_COUNT
+	};
+
+	explicit Profiler(unsigned int capacity = 600);
+
+	static const char* getChannelName(Channel channel);
+
+	// starts a new row, every channel not recorded during the frame gets 0
+	void beginFrame();
+	void endFrame();
+	// adds time to a channel of the current frame
+	void record(Channel channel, float milliseconds);
+	// adds a b2World::GetProfile(), or the sum of the profiles of several steps, to
+	// the physics channels of the current frame
+	void addStep(const b2Profile& profile, unsigned int steps = 1);
+
+	const ProfileSeries& getSeries(Channel channel) const { return m_series[channel]; }
+	// physics steps taken in each frame
+	const ProfileSeries& getStepCounts() const { return m_step_counts; }
+	void clear();
+	// writes one line per stored frame, oldest first, with a column per channel.
+	// Returns false if the file can't be written
+	bool writeCSV(const std::string& filePath) const;
+
+	bool paused = false; // stops recording, e.g. to inspect a spike
+
+private:
+	std::vector<ProfileSeries> m_series;
+	ProfileSeries m_step_counts;
+	float m_current[CHANNEL_COUNT];
+	unsigned int m_current_steps;
+};
+
+// adds the CPU time between construction and destruction, or stop(), to a profiler channel
+class ScopedTimer {
+public:
+	ScopedTimer(Profiler& profiler, Profiler::Channel channel)
+		: m_profiler(profiler), m_channel(channel), m_start(std::chrono::steady_clock::now()), m_running(true) {}
+	~ScopedTimer() { stop(); }
+	// records the time now, for sections that end before the scope does
+	void stop()
+	{
+		if (!m_running)
+			return;
+		std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - m_start;
+		m_profiler.record(m_channel, elapsed.count());
+		m_running = false;
+	}
+private:
+	Profiler& m_profiler;
+	Profiler::Channel m_channel;
+	std::chrono::steady_clock::time_point m_start;
+	bool m_running;
+};
+
+#endif
@@ -3,13 +3,12 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <box2d/box2d.h>
-#include "box2DObject.h"
+#include <chrono>
 #include <iostream>
 #include <vector>
 #include <map>
+#include <algorithm>
 #include <random>
-#include <fstream>
-#include <cctype>
 #include "resource_manager.h"
 #include "sprite_renderer.h"
 #include "texture.h"
@@ -19,29 +18,23 @@
 #include <imgui/imgui_impl_glfw.h>
 #include <imgui/imgui_impl_opengl3.h>
 #include "framebuffer.h"
+#include "render_state.h"
 #include "simulation_manager.h"
+#include "canvas.h"
+#include "scene_file.h"
+#include "canvas_index.h"
+#include "profiler.h"
+#include "gpu_timer.h"
+#include "frame_pacer.h"
+#include "camera_2d.h"
+#include "particle_system.h"
+#include "particle_renderer.h"
+#include "text_renderer.h"
+#include "frame_arena.h"
+#include "heap_counter.h"
 #include "ImGuiFileBrowser.h"
 
 #define PI atan(1) * 4
-// structure for holding shape data for drawing
-// p1: top-left corner, p2: bottom-right corner, color: shape color
-
-  typedef struct Shape {
-        std::string name;
-        ImVec2 p1;
-        ImVec2 p2;
-        ImVec4 color;
-        b2BodyType type;
-        float area; 
-        float rotation;
-
-        void reset()
-        {
-            p1 = ImVec2(0.0f, 0.0f);
-            p2 = ImVec2(0.0f, 0.0f);
-            area = -1.0f;
-        }
-    } Shape_t ;
 
 // callback for registering the pressed keys
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mode);
@@ -49,34 +42,45 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 void windowSizeCallback(GLFWwindow* window, int width, int height);
 // callback for registering the mouse buttons
 void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
-// limits the FPS to a given amount
-void limitFPS(double* last_time, float targetFPS);
-// save a canva sketch to file
-void saveCanvasFile(const std::string& filePath, const std::map<int, ImVector<Shape_t>>& shapes);
-// loads a canva sketch form file
-void loadCanvasFile(const std::string& filePath, std::map<int, ImVector<Shape_t>>* shapes);
-// creates a box Box2D object from a canva sketch
-void createBoxObject(const ImVec2 origin, const Shape_t& shape);
-// creates a static Box2D object 
-void createWallObject(const ImVec2 origin, const Shape_t& shape);
-// creates a circle Box2D object
-void createCircleObject(const ImVec2 origin, const Shape_t& shape);
 // checks if two points in the canva are overlapping. Returns true if they overlap
 bool checkPointsOverlapping(ImVec2 p1, ImVec2 p2);
 // checks if a point is inside a given rectangluar area
 bool isPointInGivenArea(Shape_t area, ImVec2 point);
 // draw a rotated shae in the canva
 void drawRotatedQuad(ImDrawList* draw_list, ImVec2 origin, Shape_t shape);
+// draws a shape of the given canva group (0: line, 1: rectangle, 2: circle)
+void drawCanvasShape(ImDrawList* draw_list, ImVec2 origin, int group, const Shape_t& shape);
+// true if the shape lies inside the selection rectangle. The corners of rectangles are
+// taken before rotation, so that rotating does not drop them from the selection
+bool isShapeInSelection(const Shape_t& selection, int group, const Shape_t& shape);
+// position of the Box2D body of a canva shape, in Box2D units
+b2Vec2 getShapeBodyPosition(int group, const Shape_t& shape);
+// shows the frame timings recorded by the profiler
+void showProfilerWindow(Profiler& profiler);
 
 
 
 // screen dimentions
 const unsigned int SCREEN_WIDTH = 1200;
 const unsigned int SCREEN_HEIGHT = 800;
-// scaling factor for transforming Box2D dimensions in rendering dimensions
+// scaling factor for transforming Box2D dimensions in rendering dimensions, also the
+// pixels per Box2D unit of the scene camera at zoom 1
 const float RENDER_SCALE = 30.0f;
 // maximum FPS
 const float TARGET_FPS = 60.0f;
+// time each frame may spend uploading textures loaded in the background, in ms
+const float UPLOAD_BUDGET_MS = 2.0f;
+// bodies this close to the view (Box2D units) are still drawn, so that they don't pop
+// in at the border between two physics steps
+const float VIEW_MARGIN = 1.0f;
+// particles alive at most, and the ones spawned by a click in the scene
+const unsigned int MAX_PARTICLES = 131072;
+const unsigned int DEBRIS_PARTICLES = 400;
+// font of the body labels, shipped next to the textures, rasterized at LABEL_PIXELS pixels.
+// LABEL_HEIGHT is in Box2D units
+const char* LABEL_FONT = "fonts/DejaVuSans.ttf";
+const unsigned int LABEL_PIXELS = 48;
+const float LABEL_HEIGHT = 0.4f;
 
 // Arrays for storing pressed and processed keys
 bool keys[1024];
@@ -88,6 +92,13 @@ bool mouse_keys_processed[3];
 // manages the simulation objects and parameters 
 FrameBuffer scene_buffer = FrameBuffer();
 SimulationManager simulation_manager = SimulationManager(RENDER_SCALE, SCREEN_WIDTH, SCREEN_HEIGHT);
+// per-frame timings of the physics, CPU and GPU work, and the GPU timer of the scene pass
+Profiler profiler;
+GpuTimer scene_timer;
+// paces the main loop to TARGET_FPS, see FramePacer
+FramePacer frame_pacer(TARGET_FPS);
+// transient data of the frame, released at the end of every frame
+FrameArena frame_arena;
 
 int main(int argc, char* argv[]) 
 {
@@ -102,7 +113,7 @@ int main(int argc, char* argv[])
 
     GLFWwindow* window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Engine 2D", nullptr, nullptr);
     glfwMakeContextCurrent(window);
-    //glfwSwapInterval(1);
+    glfwSwapInterval(frame_pacer.getSwapInterval());
 
     // glad: load all OpenGL function pointers
     // ---------------------------------------
@@ -116,22 +127,51 @@ int main(int argc, char* argv[])
     glfwSetWindowSizeCallback(window, windowSizeCallback);
     glfwSetMouseButtonCallback(window, mouseButtonCallback);
 
+    // shaders and textures edited while the editor runs are reloaded in place
+    ResourceManager::enableHotReload();
     // load shaders
     ResourceManager::loadShader("shaders source/vertex.vs", "shaders source/fragment.fs", nullptr, "sprite");
-    ResourceManager::loadTexture("textures/container.jpg", false, "container");
-    ResourceManager::loadTexture("textures/bricks2.jpg", false, "bricks");
-    ResourceManager::loadTexture("textures/awesomeface.png", true, "ball");
-    ResourceManager::getTexture("container");
-    ResourceManager::getTexture("bricks");
-    ResourceManager::getTexture("ball");
-    // configure shaders
-    glm::mat4 proj = glm::ortho(0.0f, static_cast<float>(SCREEN_WIDTH), static_cast<float>(SCREEN_HEIGHT),
-        0.0f, -1.0f, 0.0f);
+    ResourceManager::loadShader("shaders source/vertex_instanced.vs", "shaders source/fragment_instanced.fs", nullptr, "sprite_instanced");
+    ResourceManager::loadShader("shaders source/particle.vs", "shaders source/particle.fs", nullptr, "particle");
+    ResourceManager::loadTextureAsync("textures/particle.png", true, "particle");
+    ResourceManager::loadShader("shaders source/text_2d.vs", "shaders source/text_2d.fs", nullptr, "text");
+    // body textures share one atlas, so the scene is drawn without texture switches. They are
+    // decoded in the background and the atlas is built once they are all in, see processUploads
+    ResourceManager::loadAtlasTextureAsync("textures/container.jpg", "container");
+    ResourceManager::loadAtlasTextureAsync("textures/bricks2.jpg", "bricks");
+    ResourceManager::loadAtlasTextureAsync("textures/awesomeface.png", "ball");
+    // texture table indexed by BodyStore::texture_ids, the defaults follow the BodyKind order.
+    // The regions point to the placeholder texture until the atlas is ready
+    const char* body_texture_names[] = { "container", "bricks", "ball" };
+    TextureRegion body_textures[IM_ARRAYSIZE(body_texture_names)];
+    for (int i = 0; i < IM_ARRAYSIZE(body_texture_names); i++)
+        body_textures[i] = ResourceManager::getTextureRegion(body_texture_names[i]);
+    // configure shaders. The scene is drawn in Box2D units, the camera block maps them to the view
+    Camera2D camera(glm::vec2(SCREEN_WIDTH, SCREEN_HEIGHT), RENDER_SCALE);
+    camera.init();
     ResourceManager::getShader("sprite").use().setInteger("image", 0);
-    ResourceManager::getShader("sprite").use().setMatrix4("projection", proj);
-
-    double last_time = glfwGetTime();
-    SpriteRenderer* renderer = new SpriteRenderer(ResourceManager::getShader("sprite"));
+    ResourceManager::getShader("sprite").bindUniformBlock("Camera", Camera2D::UNIFORM_BINDING);
+    ResourceManager::getShader("sprite_instanced").use().setInteger("image", 0);
+    ResourceManager::getShader("sprite_instanced").bindUniformBlock("Camera", Camera2D::UNIFORM_BINDING);
+    ResourceManager::getShader("particle").use().setInteger("image", 0);
+    ResourceManager::getShader("particle").bindUniformBlock("Camera", Camera2D::UNIFORM_BINDING);
+    ResourceManager::getShader("text").use().setInteger("text", 0);
+    ResourceManager::getShader("text").bindUniformBlock("Camera", Camera2D::UNIFORM_BINDING);
+
+    SpriteRenderer* renderer = new SpriteRenderer(ResourceManager::getShader("sprite"), ResourceManager::getShader("sprite_instanced"));
+
+    // visual debris and effects, simulated next to the world. They bounce on a copy of the
+    // static bodies, taken when the simulation starts or is reset
+    ParticleSystem particles(MAX_PARTICLES);
+    ParticleRenderer* particle_renderer = new ParticleRenderer(ResourceManager::getShader("particle"), particles.getCapacity());
+    ParticleParams debris_params;
+    std::vector<BodyState> static_bodies;
+    int fountain = -1; // emitter index
+
+    // names of the bodies drawn over them in the scene
+    TextRenderer* text_renderer = new TextRenderer(ResourceManager::getShader("text"));
+    text_renderer->loadFont(LABEL_FONT, LABEL_PIXELS);
+    bool show_labels = false;
 
     // GUI initialization
     // --------
@@ -163,6 +203,8 @@ int main(int argc, char* argv[])
     ImGui_ImplOpenGL3_Init("#version 330");
     
     ImGuiWindowFlags rendering_window_flags = 0;
+    // the mouse wheel zooms the camera
+    rendering_window_flags |= ImGuiWindowFlags_NoScrollWithMouse;
     ImGuiWindowFlags canva_window_flags = 0;
 
     /*rendering_window_flags |= ImGuiWindowFlags_NoResize;
@@ -178,14 +220,45 @@ int main(int argc, char* argv[])
 
     // buffer initialization for rendering the simulation
     scene_buffer.init(SCREEN_WIDTH, SCREEN_HEIGHT);
+    scene_timer.init();
+    // from here on the world is stepped by the simulation thread, the loop below only
+    // posts edits and draws the published snapshots
+    simulation_manager.startThread();
 
     // ImGUI initial color settings
     ImVec4 clear_color = ImVec4(0.3f, 0.4f, 0.8f, 1.0f);
     ImVec4 shape_color = ImVec4(1.0f, 0.0f, 0.5f, 1.0f);
 
+    // GL bind and uniform upload counters of the previous frame, shown in the control window
+    RenderState::Counters bind_counters;
+    unsigned int skipped_uploads = 0;
+    // bodies drawn by the scene pass of the previous frame, out of all the bodies in the world
+    unsigned int drawn_bodies = 0, total_bodies = 0;
+    b2AABB view_bounds = {};
+    // heap allocations of the main thread during the previous frame, shown in the Control window
+    unsigned long long frame_allocations = 0;
+
     while (!glfwWindowShouldClose(window)) 
     {
+        const unsigned long long allocations_at_start = HeapCounter::getAllocations();
         glfwPollEvents();
+        // the ImGui backend binds its own objects, start every frame from unknown GL state
+        RenderState::invalidate();
+        RenderState::resetCounters();
+        Shader::resetSkippedUploads();
+        // upload the textures decoded since the last frame and reload the edited resources
+        bool textures_changed = ResourceManager::processUploads(UPLOAD_BUDGET_MS);
+        textures_changed |= ResourceManager::processReloads();
+        if (textures_changed)
+            for (int i = 0; i < IM_ARRAYSIZE(body_texture_names); i++)
+                body_textures[i] = ResourceManager::getTextureRegion(body_texture_names[i]);
+        profiler.beginFrame();
+        simulation_manager.collectProfile(profiler);
+        ScopedTimer frame_timer(profiler, Profiler::FRAME);
+        // GPU times of the scene pass of previous frames, the queries lag a few frames behind
+        float gpu_scene_time;
+        while (scene_timer.getResult(&gpu_scene_time))
+            profiler.record(Profiler::GPU_SCENE, gpu_scene_time);
         // imgui frame creation
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
@@ -202,9 +275,14 @@ int main(int argc, char* argv[])
         ImGui::Begin("Control");
         if (ImGui::Button("Play")) 
         {
+            // the state the simulation starts from is what Reset goes back to
+            if (simulation_manager.simulation_state == SimulationState::STOP)
+                simulation_manager.captureState();
             simulation_manager.simulation_state = SimulationState::PLAY;
             simulation_manager.play = true;
             simulation_manager.simulate = true;
+            simulation_manager.getStaticBodies(static_bodies);
+            particles.setColliders(static_bodies);
         }
         ImGui::SameLine();
         if (ImGui::Button("Pause"))
@@ -218,6 +296,7 @@ int main(int argc, char* argv[])
             simulation_manager.simulation_state = SimulationState::STOP;
             simulation_manager.stop = true;
             simulation_manager.play = false;
+            simulation_manager.simulate = false;
         }
         ImGui::SameLine(ImGui::GetWindowWidth() - 130.0f);
         if (ImGui::Checkbox("Enable gravity", &simulation_manager.gravity_on))
@@ -225,19 +304,96 @@ int main(int argc, char* argv[])
 
         ImGui::ColorEdit3("background color", (float*)&clear_color);
 
+        // physics rate, independent from the display rate
+        static int physics_rate = 60;
+        static int max_sub_steps = 5;
+        if (ImGui::SliderInt("physics rate (Hz)", &physics_rate, 30, 240))
+            simulation_manager.setTimeStep(1.0f / physics_rate);
+        if (ImGui::SliderInt("max steps per frame", &max_sub_steps, 1, 16))
+            simulation_manager.setMaxSubSteps(max_sub_steps);
+        // bodies spread over parallel worlds, 1 steps a single world
+        static int physics_workers = 1;
+        if (ImGui::SliderInt("physics threads", &physics_workers, 1, 16))
+            simulation_manager.setWorkerCount(physics_workers);
+
+        // frame pacing
+        static int pacing_mode = static_cast<int>(frame_pacer.getMode());
+        static float target_fps = TARGET_FPS;
+        if (ImGui::Combo("frame pacing", &pacing_mode, "Limited\0VSync\0Unlimited\0"))
+        {
+            frame_pacer.setMode(static_cast<PacingMode>(pacing_mode));
+            glfwSwapInterval(frame_pacer.getSwapInterval());
+        }
+        if (frame_pacer.getMode() == PacingMode::LIMITED && ImGui::SliderFloat("target FPS", &target_fps, 15.0f, 240.0f, "%.0f"))
+            frame_pacer.setTargetFPS(target_fps);
+
         ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / io.Framerate, io.Framerate);
+        ImGui::Text("frame jitter %.3f ms, p99 %.3f ms", frame_pacer.getJitter(), frame_pacer.getFrameTimes().percentile99());
+        ImGui::Text("work %.2f ms, sleep %.2f ms, spin %.2f ms (window %.2f ms)", frame_pacer.getWorkTimes().average(),
+            frame_pacer.getSleepTimes().average(), frame_pacer.getSpinTimes().average(), frame_pacer.getSpinThreshold());
+        ImGui::Text("GL binds: %u issued, %u skipped, uniform uploads skipped: %u", bind_counters.issued, bind_counters.skipped, skipped_uploads);
+        ImGui::Text("bodies drawn: %u / %u", drawn_bodies, total_bodies);
+        ImGui::Text("heap allocations: %llu, frame arena: %zu / %zu KB", frame_allocations, frame_arena.getPeak() / 1024, frame_arena.getCapacity() / 1024);
+        if (ResourceManager::getPendingLoads() > 0)
+            ImGui::Text("loading textures: %u left", ResourceManager::getPendingLoads());
+
+        // scene camera, also driven by the mouse over the Rendering window
+        ImGui::SliderFloat("zoom", &camera.zoom, Camera2D::MIN_ZOOM, Camera2D::MAX_ZOOM, "%.2f", ImGuiSliderFlags_Logarithmic);
+        ImGui::SliderAngle("camera rotation", &camera.rotation, -180.0f, 180.0f);
+        if (ImGui::Button("Reset camera"))
+            camera.reset();
+        ImGui::SameLine();
+        ImGui::Text("camera at (%.1f, %.1f)", camera.position.x, camera.position.y);
+
+        // particles: a left click in the scene spawns debris, the fountain follows the camera
+        bool fountain_on = fountain >= 0;
+        if (ImGui::Checkbox("particle fountain", &fountain_on))
+        {
+            if (fountain_on)
+                fountain = particles.createEmitter(camera.position, 2000.0f, debris_params);
+            else
+            {
+                particles.destroyEmitter(fountain);
+                fountain = -1;
+            }
+        }
+        if (fountain >= 0)
+        {
+            ImGui::SameLine();
+            ImGui::SliderFloat("rate", &particles.getEmitter(fountain).rate, 100.0f, 100000.0f, "%.0f /s", ImGuiSliderFlags_Logarithmic);
+            particles.getEmitter(fountain).position = camera.position;
+        }
+        ImGui::Checkbox("particles bounce on static bodies", &particles.collisions);
+        ImGui::Text("particles: %u / %u", particles.getCount(), particles.getCapacity());
+        if (text_renderer->isLoaded())
+        {
+            ImGui::Checkbox("body labels", &show_labels);
+            if (show_labels)
+            {
+                ImGui::SameLine();
+                ImGui::Text("%u glyphs, %u cached strings", text_renderer->getGlyphCount(), text_renderer->getCachedRuns());
+            }
+        }
+        else
+            ImGui::TextDisabled("body labels: can't load %s", LABEL_FONT);
         ImGui::End();
 
+        showProfilerWindow(profiler);
+
         // Canva window
         // ------------
+        ScopedTimer canvas_timer(profiler, Profiler::CANVAS);
         ImGui::Begin("Canva", nullptr, canva_window_flags);
 
         // Canvas variables initialization
-        static std::map<int, ImVector<Shape_t>> shapes; // container for the shapes in the canva
-        std::map<int, ImVector<Shape_t>>::iterator shapes_it; // iterator for iterating through the shapes in the canva
+        static CanvasShapes shapes; // container for the shapes in the canva
+        CanvasShapes::iterator shapes_it; // iterator for iterating through the shapes in the canva
         static Shape_t selection_shape; // rectangle for selecting other figures
         static bool selection_shape_active = false; // set to true when the selection shape has been put on the canva
         static bool show_select_shape = true; // when moving we want to hide the selecting rectangle
+        static CanvasIndex canvas_index; // bounds of the shapes, for picking, selection and culling
+        static std::vector<ShapeRef> selected_shapes; // shapes inside the selection rectangle
+        static std::vector<ShapeRef> visible_shapes; // shapes overlapping the visible part of the canva
         static ImVec2 scrolling(0.0f, 0.0f); // to track mouse movement when moving a figure
         static bool opt_enable_grid = true; // enable the grid 
         static bool opt_enable_context_menu = true; // enable menu for deleting figures
@@ -249,12 +405,14 @@ int main(int argc, char* argv[])
         // Flags for canva menu
         static bool show_file_open = false;
         static bool show_file_save = false;
+        static bool show_snapshot_save = false; // world state captured at Play
         if (ImGui::BeginMenuBar())
         {
             if (ImGui::BeginMenu("File"))
             {
                 ImGui::MenuItem("Open", NULL, &show_file_open);
                 ImGui::MenuItem("Save", NULL, &show_file_save);
+                ImGui::MenuItem("Save snapshot", NULL, &show_snapshot_save, simulation_manager.hasCapturedState());
 
                 ImGui::EndMenu();
             }
@@ -310,6 +468,18 @@ int main(int argc, char* argv[])
                     selection_shape.p2 = mouse_pos_in_canva;
                     selection_shape.color = ImVec4(1.0f, 1.0f, 1.0f, 0.15f);
                     selection_shape_active = false;
+                    // clicking on a shape selects it alone
+                    ShapeRef picked;
+                    if (canvas_index.pick(shapes, mouse_pos_in_canva, &picked))
+                    {
+                        const Shape_t& shape = shapes[picked.group][picked.index];
+                        b2AABB bounds = picked.group == 2 ? CanvasIndex::getBounds(picked.group, shape) : CanvasIndex::getBounds(0, shape);
+                        selection_shape.p1 = ImVec2(bounds.lowerBound.x - 1.0f, bounds.lowerBound.y - 1.0f);
+                        selection_shape.p2 = ImVec2(bounds.upperBound.x + 1.0f, bounds.upperBound.y + 1.0f);
+                        selection_shape_active = true;
+                        if (picked.group == 1)
+                            rotate_amount = shape.rotation;
+                    }
                 }
             }
             else
@@ -362,6 +532,7 @@ int main(int argc, char* argv[])
                     // delete figure if area too small or p1 and p2 overlap
                     if (shapes[current_item].back().area > 100 || !checkPointsOverlapping(shapes[current_item].back().p1, shapes[current_item].back().p2))
                     {
+                        canvas_index.insert(current_item, static_cast<unsigned int>(shapes[current_item].size() - 1), shapes[current_item].back());
                         switch (is_object_static)
                         {
                         case 0:
@@ -370,13 +541,13 @@ int main(int argc, char* argv[])
                             switch (current_item)
                             {
                             case 0:
-                                createBoxObject(origin, shapes[current_item].back());
+                                shapes[current_item].back().body = createBoxObject(simulation_manager, shapes[current_item].back());
                                 break;
                             case 1:
-                                createBoxObject(origin, shapes[current_item].back());
+                                shapes[current_item].back().body = createBoxObject(simulation_manager, shapes[current_item].back());
                                 break;
                             case 2:
-                                createCircleObject(origin, shapes[current_item].back());
+                                shapes[current_item].back().body = createCircleObject(simulation_manager, shapes[current_item].back());
                                 break;
                             }
                             break;
@@ -384,13 +555,13 @@ int main(int argc, char* argv[])
                             switch (current_item)
                             {
                             case 0:
-                                createWallObject(origin, shapes[current_item].back());
+                                shapes[current_item].back().body = createWallObject(simulation_manager, shapes[current_item].back());
                                 break;
                             case 1:
-                                createWallObject(origin, shapes[current_item].back());
+                                shapes[current_item].back().body = createWallObject(simulation_manager, shapes[current_item].back());
                                 break;
                             case 2:
-                                createCircleObject(origin, shapes[current_item].back());
+                                shapes[current_item].back().body = createCircleObject(simulation_manager, shapes[current_item].back());
                                 break;
                             }
                             break;
@@ -420,16 +591,18 @@ int main(int argc, char* argv[])
                 shapes[current_item].resize(shapes.size() - 1);
             adding_line = false;
             // remove last item added in the canva
-            if (ImGui::MenuItem("Remove one", NULL, false, shapes.size() > 0))
+            if (ImGui::MenuItem("Remove one", NULL, false, !shapes[current_item].empty()))
             {
-                shapes[current_item].resize(shapes[current_item].size() - 1);
-                simulation_manager.clearLastObject();
+                simulation_manager.destroyObject(shapes[current_item].back().body);
+                canvas_index.removeLast(current_item);
+                shapes[current_item].pop_back();
             }
             // remove all the items in the canva
             if (ImGui::MenuItem("Remove all", NULL, false, shapes.size() > 0))
             {
                 for (shapes_it = shapes.begin(); shapes_it !=shapes.end(); shapes_it++)
                     shapes_it->second.clear();
+                canvas_index.clear();
                 simulation_manager.clearObjects();
             }
             ImGui::EndPopup();
@@ -458,55 +631,59 @@ int main(int argc, char* argv[])
                 rotate_amount -= 2.5f;
         }
 
-        // draw figures to the canva
-        for (shapes_it = shapes.begin(); shapes_it !=shapes.end(); shapes_it++)
+        // rotate or move the selected figures. The index finds the candidates, the
+        // selection test keeps the ones fully inside the rectangle
+        selected_shapes.clear();
+        if (select_shape && selection_shape_active)
         {
-            for (int n = 0; n < shapes_it->second.Size; n++)
+            canvas_index.query(selection_shape.p1, selection_shape.p2, &selected_shapes);
+            selected_shapes.erase(std::remove_if(selected_shapes.begin(), selected_shapes.end(), [&](const ShapeRef& ref) {
+                return !isShapeInSelection(selection_shape, ref.group, shapes[ref.group][ref.index]);
+            }), selected_shapes.end());
+
+            const bool dragging = modify_shape == 1 && is_active && ImGui::IsMouseDragging(ImGuiMouseButton_Left, mouse_threshold_for_pan);
+            for (const ShapeRef& ref : selected_shapes)
             {
-                switch (shapes_it->first)
+                Shape_t& shape = shapes[ref.group][ref.index];
+                if (modify_shape == 0 && ref.group == 1 && shape.rotation != rotate_amount)
                 {
-                case 0:
-                    draw_list->AddLine(ImVec2(origin.x + shapes[0][n].p1.x, origin.y + shapes[0][n].p1.y), ImVec2(origin.x + shapes[0][n].p2.x, origin.y + shapes[0][n].p2.y), ImGui::ColorConvertFloat4ToU32(shapes[0][n].color), 2.0f);
-                    break;
-                case 1:
-                    if (select_shape && isPointInGivenArea(selection_shape, shapes_it->second[n].p1) && isPointInGivenArea(selection_shape, shapes_it->second[n].p2) && selection_shape_active)
-                    {
-                        if (modify_shape == 0)
-                        {
-                            shapes_it->second[n].rotation = rotate_amount;
+                    shape.rotation = rotate_amount;
 
-                            // save rotation to simulation
-                            simulation_manager.m_objects[1][n].setRotation(glm::radians(-rotate_amount));
-                        }
-                        else if (modify_shape == 1)
-                        {
-                            if (is_active && ImGui::IsMouseDragging(ImGuiMouseButton_Left, mouse_threshold_for_pan))
-                            {
-                                show_select_shape = false;
-                                shapes_it->second[n].p1.x += io.MouseDelta.x;
-                                shapes_it->second[n].p1.y += io.MouseDelta.y;
-                                shapes_it->second[n].p2.x += io.MouseDelta.x;
-                                shapes_it->second[n].p2.y += io.MouseDelta.y;
-
-                                selection_shape.p1.x += io.MouseDelta.x;
-                                selection_shape.p1.y += io.MouseDelta.y;
-                                selection_shape.p2.x += io.MouseDelta.x;
-                                selection_shape.p2.y += io.MouseDelta.y;
-
-                                simulation_manager.m_objects[1][n].setPosition(b2Vec2((shapes_it->second[n].p1.x + abs(shapes_it->second[n].p1.x - shapes_it->second[n].p2.x) / 2.0f) / RENDER_SCALE, (shapes_it->second[n].p1.y + abs(shapes_it->second[n].p1.y - shapes_it->second[n].p2.y) / 2.0f) / RENDER_SCALE));
-                            }
-                            else
-                                show_select_shape = true;
-                        }
-                    }
-                    drawRotatedQuad(draw_list, origin, shapes[1][n]);
-                    break;
-                case 2:
-                    draw_list->AddCircle(ImVec2(origin.x + shapes[2][n].p1.x, origin.y + shapes[2][n].p1.y), sqrt(pow(shapes[2][n].p1.x - shapes[2][n].p2.x, 2) + pow(shapes[2][n].p1.y - shapes[2][n].p2.y, 2)), ImGui::ColorConvertFloat4ToU32(shapes[2][n].color));
-                    break;
+                    // save rotation to simulation
+                    simulation_manager.setRotation(shape.body, glm::radians(-rotate_amount));
+                    canvas_index.update(ref.group, ref.index, shape);
+                }
+                else if (dragging)
+                {
+                    shape.p1.x += io.MouseDelta.x;
+                    shape.p1.y += io.MouseDelta.y;
+                    shape.p2.x += io.MouseDelta.x;
+                    shape.p2.y += io.MouseDelta.y;
+
+                    simulation_manager.setPosition(shape.body, getShapeBodyPosition(ref.group, shape));
+                    canvas_index.update(ref.group, ref.index, shape);
+                }
+            }
+            if (modify_shape == 1)
+            {
+                show_select_shape = !(dragging && !selected_shapes.empty());
+                if (!show_select_shape)
+                {
+                    selection_shape.p1.x += io.MouseDelta.x;
+                    selection_shape.p1.y += io.MouseDelta.y;
+                    selection_shape.p2.x += io.MouseDelta.x;
+                    selection_shape.p2.y += io.MouseDelta.y;
                 }
             }
         }
+
+        // draw the figures overlapping the visible part of the canva
+        canvas_index.query(ImVec2(-scrolling.x, -scrolling.y), ImVec2(canva_sz.x - scrolling.x, canva_sz.y - scrolling.y), &visible_shapes);
+        for (const ShapeRef& ref : visible_shapes)
+            drawCanvasShape(draw_list, origin, ref.group, shapes[ref.group][ref.index]);
+        // the figure being drawn is indexed when the mouse is released
+        if (adding_line && !select_shape && !shapes[current_item].empty())
+            drawCanvasShape(draw_list, origin, current_item, shapes[current_item].back());
         // draw selection shape if needed
         if (select_shape)
         {
@@ -522,43 +699,36 @@ int main(int argc, char* argv[])
 
         if (show_file_open) ImGui::OpenPopup("Open file");
         if (show_file_save) ImGui::OpenPopup("Save file");
+        if (show_snapshot_save) ImGui::OpenPopup("Save snapshot");
         
         // load canva from file is needed
         if (file_dialog.showFileDialog("Open file", imgui_addons::ImGuiFileBrowser::DialogMode::OPEN, ImVec2(700, 310), &show_file_open))
         {
-            loadCanvasFile(file_dialog.selected_path, &shapes);
-
-            for (shapes_it = shapes.begin(); shapes_it !=shapes.end(); shapes_it++)
+            // a file that fails to load leaves the current canva and its bodies untouched
+            if (loadScene(file_dialog.selected_path, &shapes))
             {
-                for (int n = 0; n < shapes_it->second.Size; n++)
-                {
-                    switch (shapes_it->second[n].type)
-                    {
-                    case b2_dynamicBody:
-                        if (shapes_it->second[n].name == "Box")
-                            createBoxObject(origin, shapes_it->second[n]);
-                        else if (shapes_it->second[n].name == "Box")
-                            createBoxObject(origin, shapes_it->second[n]);
-                        else if (shapes_it->second[n].name == "Ball")
-                            createCircleObject(origin, shapes_it->second[n]);
-                        break;
-                    case b2_staticBody:
-                        if (shapes_it->second[n].name == "Wall")
-                            createWallObject(origin, shapes_it->second[n]);
-                        else if (shapes_it->second[n].name == "Wall")
-                            createWallObject(origin, shapes_it->second[n]);
-                        else if (shapes_it->second[n].name == "Ball")
-                            createCircleObject(origin, shapes_it->second[n]);
-                        break;
-                    }
-                }
+                simulation_manager.clearObjects();
+                createCanvasObjects(simulation_manager, shapes);
+                canvas_index.build(shapes);
             }
+            else
+                std::cout << "ERROR::SCENE: failed to load " << file_dialog.selected_path << std::endl;
         }
-        // save current canva to file
+        // save current canva to file, in the binary scene format
         if (file_dialog.showFileDialog("Save file", imgui_addons::ImGuiFileBrowser::DialogMode::SAVE, ImVec2(700, 310), &show_file_save))
-            saveCanvasFile(file_dialog.selected_path, shapes);
+        {
+            if (!saveSceneFile(file_dialog.selected_path, shapes))
+                std::cout << "ERROR::SCENE: failed to write " << file_dialog.selected_path << std::endl;
+        }
+        // save the world state captured at Play, can be replayed with the headless runner
+        if (file_dialog.showFileDialog("Save snapshot", imgui_addons::ImGuiFileBrowser::DialogMode::SAVE, ImVec2(700, 310), &show_snapshot_save))
+        {
+            if (!simulation_manager.saveState(file_dialog.selected_path))
+                std::cout << "ERROR::SNAPSHOT: failed to write " << file_dialog.selected_path << std::endl;
+        }
 
         ImGui::End();
+        canvas_timer.stop();
 
         // Rendering window
         // ----------------
@@ -566,37 +736,20 @@ int main(int argc, char* argv[])
         ImGui::SetNextWindowSize(ImVec2(2 * SCREEN_WIDTH / 3, 2 * SCREEN_HEIGHT / 3), ImGuiCond_Once);
         style.WindowPadding = ImVec2(0.0f, 0.0f);
 
+        ScopedTimer scene_cpu_timer(profiler, Profiler::SCENE);
         ImGui::Begin("Rendering", nullptr, rendering_window_flags);
         if (simulation_manager.stop)
         {
-            simulation_manager.clearObjects();
-
-            for (shapes_it = shapes.begin(); shapes_it != shapes.end(); shapes_it++)
+            // rewind the bodies in place, unless they were edited since Play
+            if (!simulation_manager.restoreState())
             {
-                for (int n = 0; n < shapes_it->second.Size; n++)
-                {
-                    switch (shapes_it->second[n].type)
-                    {
-                    case b2_dynamicBody:
-                        if (shapes_it->second[n].name == "Box")
-                            createBoxObject(origin, shapes_it->second[n]);
-                        else if (shapes_it->second[n].name == "Box")
-                            createBoxObject(origin, shapes_it->second[n]);
-                        else if (shapes_it->second[n].name == "Ball")
-                            createCircleObject(origin, shapes_it->second[n]);
-                        break;
-                    case b2_staticBody:
-                        if (shapes_it->second[n].name == "Wall")
-                            createWallObject(origin, shapes_it->second[n]);
-                        else if (shapes_it->second[n].name == "Wall")
-                            createWallObject(origin, shapes_it->second[n]);
-                        else if (shapes_it->second[n].name == "Ball")
-                            createCircleObject(origin, shapes_it->second[n]);
-                        break;
-                    }
-                }
+                simulation_manager.clearObjects();
+                createCanvasObjects(simulation_manager, shapes);
             }
             simulation_manager.stop = false;
+            particles.clear();
+            simulation_manager.getStaticBodies(static_bodies);
+            particles.setColliders(static_bodies);
         }
         if (simulation_manager.play)
         {
@@ -608,41 +761,75 @@ int main(int argc, char* argv[])
 
             // write to the custom framebuffer
             scene_buffer.bind();
+            scene_timer.begin();
             glClearColor(clear_color.x, clear_color.y, clear_color.z, clear_color.w);
             glClear(GL_COLOR_BUFFER_BIT);
 
-            // reder all the objects in the scene
-            std::map<int, std::vector<Box2DObject>>::iterator it;
-            for (it = simulation_manager.m_objects.begin(); it != simulation_manager.m_objects.end(); it++)
+            camera.uploadUniforms();
+
+            // only the bodies in view are put in the snapshots, tell the simulation when it moves
+            glm::vec2 lower, upper;
+            camera.getVisibleBounds(lower, upper);
+            b2AABB visible_bounds;
+            visible_bounds.lowerBound.Set(lower.x - VIEW_MARGIN, lower.y - VIEW_MARGIN);
+            visible_bounds.upperBound.Set(upper.x + VIEW_MARGIN, upper.y + VIEW_MARGIN);
+            if (visible_bounds.lowerBound != view_bounds.lowerBound || visible_bounds.upperBound != view_bounds.upperBound)
+            {
+                view_bounds = visible_bounds;
+                simulation_manager.setViewBounds(view_bounds);
+            }
+
+            // the simulation thread steps the world on its own clock, draw its last snapshot
+            const BodySnapshot& bodies = simulation_manager.acquireSnapshot();
+            const float alpha = bodies.getInterpolationAlpha(std::chrono::steady_clock::now());
+            drawn_bodies = bodies.size();
+            total_bodies = bodies.total_bodies;
+
+            // reder all the objects in the scene, batched by texture. Poses are interpolated
+            // between the last two physics steps
+            renderer->beginBatch();
+            for (unsigned int i = 0; i < bodies.size(); i++)
             {
-                for (int n = 0; n < it->second.size(); n++)
+                b2Vec2 position = bodies.getInterpolatedPosition(i, alpha);
+                renderer->batchSpriteBox2D(body_textures[bodies.texture_ids[i]], glm::vec2(position.x, position.y),
+                    bodies.dimensions[i], bodies.getInterpolatedAngle(i, alpha), bodies.colors[i]);
+            }
+            renderer->endBatch();
+
+            // the particles freeze with the simulation
+            if (simulation_manager.simulate)
+            {
+                ScopedTimer particles_timer(profiler, Profiler::PARTICLES);
+                const b2Vec2 gravity = simulation_manager.getGravity();
+                particles.gravity = simulation_manager.gravity_on ? glm::vec2(gravity.x, gravity.y) : glm::vec2(0.0f);
+                particles.update(io.DeltaTime);
+            }
+            particle_renderer->draw(particles, ResourceManager::getTexture("particle"));
+
+            if (show_labels)
+            {
+                // names of the bodies, pointing into the canvas shapes
+                size_t shape_count = 0;
+                for (const auto& kind : shapes)
+                    shape_count += kind.second.size();
+                FrameHashMap<BodyHandle, const std::string*> body_names(shape_count, frame_arena);
+                for (const auto& kind : shapes)
+                    for (const Shape_t& shape : kind.second)
+                        body_names[shape.body] = &shape.name;
+                text_renderer->beginBatch();
+                for (unsigned int i = 0; i < bodies.size(); i++)
                 {
-                    if (it->second[n].getName() == "Box")
-                    {
-                        glm::vec2 pos = glm::vec2(it->second[n].getBody()->GetPosition().x, it->second[n].getBody()->GetPosition().y);
-                        glm::vec2 size = it->second[n].getDimensions();
-                        renderer->drawSpriteBox2D(RENDER_SCALE, ResourceManager::getTexture("container"), pos, size, glm::degrees(it->second[n].getBody()->GetAngle()), it->second[n].getColor());
-                    }
-                    else if (it->second[n].getName() == "Wall")
-                    {
-                        glm::vec2 pos = glm::vec2(it->second[n].getBody()->GetPosition().x, it->second[n].getBody()->GetPosition().y);
-                        glm::vec2 size = it->second[n].getDimensions();
-                        renderer->drawSpriteBox2D(RENDER_SCALE, ResourceManager::getTexture("bricks"), pos, size, glm::degrees(it->second[n].getBody()->GetAngle()), it->second[n].getColor());
-                    }
-                    else if (it->second[n].getName() == "Ball")
-                    {
-                        glm::vec2 pos = glm::vec2(it->second[n].getBody()->GetPosition().x, it->second[n].getBody()->GetPosition().y);
-                        glm::vec2 size = it->second[n].getDimensions();
-                        renderer->drawSpriteBox2D(RENDER_SCALE, ResourceManager::getTexture("ball"), pos, size, glm::degrees(it->second[n].getBody()->GetAngle()), it->second[n].getColor());
-                    }
+                    auto name = body_names.find(bodies.handles[i]);
+                    if (name == body_names.end())
+                        continue;
+                    b2Vec2 position = bodies.getInterpolatedPosition(i, alpha);
+                    text_renderer->addText(*name->second, glm::vec2(position.x, position.y), LABEL_HEIGHT);
                 }
+                text_renderer->endBatch();
             }
 
+            scene_timer.end();
             scene_buffer.unbind();
-
-            // perform a step in the simulation
-            if (simulation_manager.simulate)
-                simulation_manager.m_world->Step(1.0f / 60.0f, 6, 2);
         }
         else
         {
@@ -654,13 +841,36 @@ int main(int argc, char* argv[])
 
             // write to the custom framebuffer
             scene_buffer.bind();
+            scene_timer.begin();
             glClearColor(clear_color.x, clear_color.y, clear_color.z, clear_color.w);
             glClear(GL_COLOR_BUFFER_BIT);
+            scene_timer.end();
             scene_buffer.unbind();
         }
+        // camera controls on the scene image: the wheel zooms around the cursor, right or middle drag pans
+        if (ImGui::IsItemHovered())
+        {
+            ImVec2 image_min = ImGui::GetItemRectMin();
+            ImVec2 image_size = ImGui::GetItemRectSize();
+            if (image_size.x > 0.0f && image_size.y > 0.0f)
+            {
+                glm::vec2 view_point((io.MousePos.x - image_min.x) / image_size.x, (io.MousePos.y - image_min.y) / image_size.y);
+                if (io.MouseWheel != 0.0f)
+                    camera.zoomAt(std::pow(1.1f, io.MouseWheel), view_point);
+                if (ImGui::IsMouseDragging(ImGuiMouseButton_Right) || ImGui::IsMouseDragging(ImGuiMouseButton_Middle))
+                    camera.pan(glm::vec2(io.MouseDelta.x / image_size.x, io.MouseDelta.y / image_size.y));
+                if (simulation_manager.play && ImGui::IsMouseClicked(ImGuiMouseButton_Left))
+                    particles.emit(camera.viewToWorld(view_point), DEBRIS_PARTICLES, debris_params);
+            }
+        }
         ImGui::End();
+        scene_cpu_timer.stop();
+
+        bind_counters = RenderState::getCounters();
+        skipped_uploads = Shader::getSkippedUploads();
 
         //ImGui::ShowDemoWindow();
+        ScopedTimer imgui_timer(profiler, Profiler::IMGUI_RENDER);
         ImGui::Render();
 
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
@@ -674,10 +884,17 @@ int main(int argc, char* argv[])
             ImGui::RenderPlatformWindowsDefault();
             glfwMakeContextCurrent(backup_current_context);
         }
+        imgui_timer.stop();
+        frame_timer.stop();
+        profiler.endFrame();
 
+        frame_pacer.markWorkDone();
         glfwSwapBuffers(window);
-        limitFPS(&last_time, TARGET_FPS);
+        frame_pacer.wait();
+        frame_allocations = HeapCounter::getAllocations() - allocations_at_start;
+        frame_arena.reset();
     }
+    simulation_manager.stopThread();
     glfwTerminate();
     return 0;
 }
@@ -712,109 +929,63 @@ void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
     }
 }
 
-void limitFPS(double* last_time, const float targetFPS) 
-{
-    while (glfwGetTime() < *last_time + 1.0f / targetFPS) { ; }
-    *last_time += 1.0f / targetFPS;
-}
-
-void windowSizeCallback(GLFWwindow* window, int width, int height) 
-{
-    glViewport(0, 0, width, height);
-    scene_buffer.rescaleFrameBuffer(width, height);
-}
-
-void saveCanvasFile(const std::string& filePath, const std::map<int,ImVector<Shape_t>>& shapes)
-{
-    std::ofstream outfile(filePath, std::ios_base::app);
-
-    outfile << "{" << '\n';
-
-    std::map<int, ImVector<Shape_t>>::const_iterator shapes_it;
-    for (shapes_it = shapes.begin(); shapes_it !=shapes.end(); shapes_it++)
-    {
-        outfile << "\t[" << shapes_it->first << "]:\n\t{\n";
-        for (auto& shape : shapes_it->second)
-        {
-            outfile << "\t\t";
-            outfile << shape.name << "," << "(" << shape.p1.x << ", " << shape.p1.y << "), " << "(" << shape.p2.x << ", " << shape.p2.y << "), "
-                << "(" << shape.color.x << "," << shape.color.y << "," << shape.color.z << "," << shape.color.w << "),"
-                << shape.type << "," << shape.area << "," << shape.rotation << " \n";
-        }
-        outfile << "\t}\n";
-    }
-    outfile << "}";
-}
-
-void loadCanvasFile(const std::string& filePath, std::map<int, ImVector<Shape_t>>* shapes)
+void showProfilerWindow(Profiler& profiler)
 {
-    simulation_manager.clearObjects();
-    (*shapes).clear();
-    std::ifstream infile(filePath, std::ios_base::in);
-    std::string buffer;
-
-    int element_number{};
-    if (infile.is_open())
+    ImGui::Begin("Profiler");
+    ImGui::Checkbox("Pause", &profiler.paused);
+    ImGui::SameLine();
+    if (ImGui::Button("Clear"))
+        profiler.clear();
+    ImGui::SameLine();
+    static char csv_path[256] = "profile.csv";
+    if (ImGui::Button("Dump CSV") && !profiler.writeCSV(csv_path))
+        std::cout << "ERROR::PROFILER: failed to write " << csv_path << std::endl;
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(-1.0f);
+    ImGui::InputText("##csv", csv_path, sizeof(csv_path));
+
+    const ProfileSeries& steps = profiler.getStepCounts();
+    ImGui::Text("%u frames, %.1f physics steps per frame", steps.size(), steps.average());
+
+    // one row per channel: statistics over the stored frames and the timeline
+    if (ImGui::BeginTable("channels", 6, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit))
     {
-        while (infile)
+        ImGui::TableSetupColumn("channel");
+        ImGui::TableSetupColumn("last");
+        ImGui::TableSetupColumn("min");
+        ImGui::TableSetupColumn("avg");
+        ImGui::TableSetupColumn("p99");
+        ImGui::TableSetupColumn("timeline (ms)", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableHeadersRow();
+        for (int channel = 0; channel < Profiler::CHANNEL_COUNT; channel++)
         {
-            std::getline(infile, buffer);
-            for (unsigned int i = 0; i < buffer.length(); i++)
-            {
-                if (buffer[i] == '[')
-                    element_number = int(buffer[i + 1] - '0'); // converts char to int
-                else if (buffer[i] == '\t' && buffer[i + 1] == '\t')
-                {
-                    std::vector<float> values;
-                    std::string b;
-                    std::string name;
-                    bool proc_string = false;
-                    for (auto& el : buffer)
-                    {
-                        if (std::isdigit(el) || el == '.') // retrieves numbers
-                            b += el;
-                        else if (!std::isdigit(el) && !b.empty()) // saves the number
-                        {
-                            values.push_back(stof(b));
-                            b.clear();
-                        }
-                        else if (std::isalpha(el)) // retrieves object's name
-                            name += el;
-                    }
-                    Shape_t shape;
-                    shape.name = name;
-                    shape.p1 = ImVec2(values[0], values[1]);
-                    shape.p2 = ImVec2(values[2], values[3]);
-                    shape.color = ImVec4(values[4], values[5], values[6], values[7]);
-                    shape.type = (b2BodyType)values[8];
-                    shape.area = values[9];
-                    shape.rotation = values[10];
-                    (*shapes)[element_number].push_back(shape);
-                }
-            }
+            const ProfileSeries& series = profiler.getSeries(static_cast<Profiler::Channel>(channel));
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(Profiler::getChannelName(static_cast<Profiler::Channel>(channel)));
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", series.last());
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", series.min());
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", series.average());
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", series.percentile99());
+            ImGui::TableNextColumn();
+            ImGui::PushID(channel);
+            ImGui::PlotLines("##timeline", series.data(), static_cast<int>(series.size()), series.plotOffset(),
+                nullptr, 0.0f, FLT_MAX, ImVec2(-1.0f, 24.0f));
+            ImGui::PopID();
         }
+        ImGui::EndTable();
     }
+    ImGui::End();
 }
 
-void createBoxObject(const ImVec2 origin, const Shape_t& shape)
-{
-    Box box;
-    box.init(simulation_manager.m_world, shape.name ,glm::vec2((shape.p1.x + shape.p2.x) / 2 / RENDER_SCALE, (shape.p1.y + shape.p2.y) / 2 / RENDER_SCALE), glm::vec2(abs(shape.p1.x - shape.p2.x) / RENDER_SCALE, abs(shape.p1.y - shape.p2.y) / RENDER_SCALE), b2_dynamicBody, -shape.rotation);
-    simulation_manager.m_objects[1].push_back(box);
-}
-
-void createWallObject(const ImVec2 origin, const Shape_t& shape)
-{
-    Wall wall;
-    wall.init(simulation_manager.m_world, shape.name, glm::vec2((shape.p1.x + shape.p2.x) / 2 / RENDER_SCALE, (shape.p1.y + shape.p2.y) / 2 / RENDER_SCALE), glm::vec2(abs(shape.p1.x - shape.p2.x) / RENDER_SCALE, abs(shape.p1.y - shape.p2.y) / RENDER_SCALE), b2_staticBody, -shape.rotation);
-    simulation_manager.m_objects[1].push_back(wall);
-}
-
-void createCircleObject(const ImVec2 origin, const Shape_t& shape)
+void windowSizeCallback(GLFWwindow* window, int width, int height) 
 {
-    Circle circle;
-    circle.init(simulation_manager.m_world, shape.name, glm::vec2(shape.p1.x / RENDER_SCALE, shape.p1.y / RENDER_SCALE), sqrt(pow(shape.p1.x - shape.p2.x, 2) + pow(shape.p1.y - shape.p2.y, 2)) / RENDER_SCALE, shape.type);
-    simulation_manager.m_objects[2].push_back(circle);
+    glViewport(0, 0, width, height);
+    scene_buffer.rescaleFrameBuffer(width, height);
 }
 
 bool checkPointsOverlapping(ImVec2 p1, ImVec2 p2)
@@ -832,6 +1003,40 @@ bool isPointInGivenArea(Shape_t area, ImVec2 point)
     return 0 < glm::dot(AM, AB) && glm::dot(AM, AB) < glm::dot(AB, AB) && 0 < glm::dot(AM, AD) && glm::dot(AM, AD) < glm::dot(AD, AD);
 }
 
+void drawCanvasShape(ImDrawList* draw_list, ImVec2 origin, int group, const Shape_t& shape)
+{
+    switch (group)
+    {
+    case 0:
+        draw_list->AddLine(ImVec2(origin.x + shape.p1.x, origin.y + shape.p1.y), ImVec2(origin.x + shape.p2.x, origin.y + shape.p2.y), ImGui::ColorConvertFloat4ToU32(shape.color), 2.0f);
+        break;
+    case 1:
+        drawRotatedQuad(draw_list, origin, shape);
+        break;
+    case 2:
+        draw_list->AddCircle(ImVec2(origin.x + shape.p1.x, origin.y + shape.p1.y), sqrt(pow(shape.p1.x - shape.p2.x, 2) + pow(shape.p1.y - shape.p2.y, 2)), ImGui::ColorConvertFloat4ToU32(shape.color));
+        break;
+    }
+}
+
+bool isShapeInSelection(const Shape_t& selection, int group, const Shape_t& shape)
+{
+    if (group == 2)
+    {
+        b2AABB bounds = CanvasIndex::getBounds(group, shape);
+        return isPointInGivenArea(selection, ImVec2(bounds.lowerBound.x, bounds.lowerBound.y)) && isPointInGivenArea(selection, ImVec2(bounds.upperBound.x, bounds.upperBound.y));
+    }
+    return isPointInGivenArea(selection, shape.p1) && isPointInGivenArea(selection, shape.p2);
+}
+
+b2Vec2 getShapeBodyPosition(int group, const Shape_t& shape)
+{
+    // same centers as the canvas object factories
+    if (group == 2)
+        return b2Vec2(shape.p1.x / RENDER_SCALE, shape.p1.y / RENDER_SCALE);
+    return b2Vec2((shape.p1.x + shape.p2.x) / 2.0f / RENDER_SCALE, (shape.p1.y + shape.p2.y) / 2.0f / RENDER_SCALE);
+}
+
 void drawRotatedQuad(ImDrawList* draw_list, ImVec2 origin, Shape_t shape)
 {
     ImVec2 center((shape.p1.x + shape.p2.x) / 2.0f, (shape.p1.y + shape.p2.y) / 2.0f);
@@ -0,0 +1,80 @@
+#include "program_binary.h"
+
+#include <GLFW/glfw3.h>
+
+// GL 4.1 tokens, missing from the 3.3 core headers
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+namespace {
+	typedef void (APIENTRYP GetProgramBinaryProc)(GLuint program, GLsizei buf_size, GLsizei* length, GLenum* binary_format, void* binary);
+	typedef void (APIENTRYP ProgramBinaryProc)(GLuint program, GLenum binary_format, const void* binary, GLsizei length);
+	typedef void (APIENTRYP ProgramParameteriProc)(GLuint program, GLenum pname, GLint value);
+
+	bool initialized = false;
+	bool supported = false;
+	GetProgramBinaryProc get_program_binary = nullptr;
+	ProgramBinaryProc program_binary = nullptr;
+	ProgramParameteriProc program_parameteri = nullptr;
+}
+
+void ProgramBinary::init() {
+	if (initialized)
+		return;
+	initialized = true;
+	if (!GLAD_GL_VERSION_3_3 || glfwGetCurrentContext() == nullptr)
+		return;
+
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	if ((major < 4 || (major == 4 && minor < 1)) && !glfwExtensionSupported("GL_ARB_get_program_binary"))
+		return;
+	get_program_binary = reinterpret_cast<GetProgramBinaryProc>(glfwGetProcAddress("glGetProgramBinary"));
+	program_binary = reinterpret_cast<ProgramBinaryProc>(glfwGetProcAddress("glProgramBinary"));
+	program_parameteri = reinterpret_cast<ProgramParameteriProc>(glfwGetProcAddress("glProgramParameteri"));
+	// some drivers expose the extension without any binary format
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	supported = get_program_binary != nullptr && program_binary != nullptr && program_parameteri != nullptr && formats > 0;
+}
+
+bool ProgramBinary::isSupported() {
+	init();
+	return supported;
+}
+
+void ProgramBinary::setRetrievableHint(GLuint program) {
+	if (isSupported())
+		program_parameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+bool ProgramBinary::retrieve(GLuint program, GLenum* format, std::vector<unsigned char>* binary) {
+	if (!isSupported())
+		return false;
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return false;
+	binary->resize(length);
+	GLsizei written = 0;
+	get_program_binary(program, length, &written, format, binary->data());
+	binary->resize(written);
+	return written > 0;
+}
+
+bool ProgramBinary::load(GLuint program, GLenum format, const void* binary, GLsizei length) {
+	if (!isSupported())
+		return false;
+	program_binary(program, format, binary, length);
+	GLint success = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	return success == GL_TRUE;
+}
@@ -0,0 +1,26 @@
+#ifndef PROGRAM_BINARY_H
+#define PROGRAM_BINARY_H
+
+#include <glad/glad.h>
+#include <vector>
+
+// Access to linked program binaries (GL 4.1 or ARB_get_program_binary). The GL 3.3
+// glad loader does not provide these entry points, they are fetched through GLFW the
+// first time they are needed, with a current context. Every function is a no-op
+// returning false when the driver does not support program binaries.
+class ProgramBinary {
+public:
+	static bool isSupported();
+	// asks the driver to keep the binary of the program retrievable, call before linking
+	static void setRetrievableHint(GLuint program);
+	// reads back the binary of a linked program
+	static bool retrieve(GLuint program, GLenum* format, std::vector<unsigned char>* binary);
+	// loads a binary in the program, returns false if the driver rejects it (e.g. after
+	// a driver update), in which case the program must be linked from source
+	static bool load(GLuint program, GLenum format, const void* binary, GLsizei length);
+private:
+	ProgramBinary() {}
+	static void init();
+};
+
+#endif
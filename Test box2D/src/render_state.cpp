@@ -0,0 +1,85 @@
+#include "render_state.h"
+
+const unsigned int UNKNOWN_BINDING = ~0u;
+
+// instantiate static variables
+unsigned int RenderState::program = UNKNOWN_BINDING;
+unsigned int RenderState::active_unit = UNKNOWN_BINDING;
+unsigned int RenderState::textures[RenderState::MAX_TEXTURE_UNITS] = {
+	UNKNOWN_BINDING, UNKNOWN_BINDING, UNKNOWN_BINDING, UNKNOWN_BINDING, UNKNOWN_BINDING, UNKNOWN_BINDING, UNKNOWN_BINDING, UNKNOWN_BINDING,
+	UNKNOWN_BINDING, UNKNOWN_BINDING, UNKNOWN_BINDING, UNKNOWN_BINDING, UNKNOWN_BINDING, UNKNOWN_BINDING, UNKNOWN_BINDING, UNKNOWN_BINDING
+};
+unsigned int RenderState::vertex_array = UNKNOWN_BINDING;
+unsigned int RenderState::framebuffer = UNKNOWN_BINDING;
+RenderState::Counters RenderState::counters;
+
+bool RenderState::update(unsigned int& current, unsigned int value) {
+	if (current == value) {
+		counters.skipped++;
+		return false;
+	}
+	current = value;
+	counters.issued++;
+	return true;
+}
+
+void RenderState::useProgram(unsigned int program) {
+	if (update(RenderState::program, program))
+		glUseProgram(program);
+}
+
+void RenderState::activeTexture(unsigned int unit) {
+	if (update(active_unit, unit))
+		glActiveTexture(GL_TEXTURE0 + unit);
+}
+
+void RenderState::bindTexture(unsigned int texture) {
+	// without a known active unit the binding can't be tracked
+	if (active_unit >= MAX_TEXTURE_UNITS) {
+		glBindTexture(GL_TEXTURE_2D, texture);
+		counters.issued++;
+		return;
+	}
+	if (update(textures[active_unit], texture))
+		glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+void RenderState::bindVertexArray(unsigned int vertex_array) {
+	if (update(RenderState::vertex_array, vertex_array))
+		glBindVertexArray(vertex_array);
+}
+
+void RenderState::bindFramebuffer(unsigned int framebuffer) {
+	if (update(RenderState::framebuffer, framebuffer))
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+void RenderState::forgetProgram(unsigned int program) {
+	if (RenderState::program == program)
+		RenderState::program = UNKNOWN_BINDING;
+}
+
+void RenderState::forgetTexture(unsigned int texture) {
+	for (unsigned int i = 0; i < MAX_TEXTURE_UNITS; i++)
+		if (textures[i] == texture)
+			textures[i] = UNKNOWN_BINDING;
+}
+
+void RenderState::forgetVertexArray(unsigned int vertex_array) {
+	if (RenderState::vertex_array == vertex_array)
+		RenderState::vertex_array = UNKNOWN_BINDING;
+}
+
+void RenderState::forgetFramebuffer(unsigned int framebuffer) {
+	if (RenderState::framebuffer == framebuffer)
+		RenderState::framebuffer = UNKNOWN_BINDING;
+}
+
+void RenderState::invalidate() {
+	program = UNKNOWN_BINDING;
+	active_unit = UNKNOWN_BINDING;
+	for (unsigned int i = 0; i < MAX_TEXTURE_UNITS; i++)
+		textures[i] = UNKNOWN_BINDING;
+	vertex_array = UNKNOWN_BINDING;
+	framebuffer = UNKNOWN_BINDING;
+}
@@ -0,0 +1,55 @@
+#ifndef RENDER_STATE_H
+#define RENDER_STATE_H
+
+#include <glad/glad.h>
+
+// A static tracker of the GL objects currently bound to the context: program,
+// active texture unit, 2D textures per unit, vertex array and draw framebuffer.
+// Binding an object that is already bound is skipped. Code that binds objects
+// behind the tracker's back (e.g. the ImGui backend) must be followed by a call to
+// invalidate(), and deleted objects must be forgotten since GL reuses their names.
+
+class RenderState {
+public:
+	static const unsigned int MAX_TEXTURE_UNITS = 16;
+
+	// bind calls issued to GL and skipped because they were no-ops
+	struct Counters {
+		unsigned int issued = 0;
+		unsigned int skipped = 0;
+	};
+
+	static void useProgram(unsigned int program);
+	// selects GL_TEXTURE0 + unit
+	static void activeTexture(unsigned int unit);
+	// binds a GL_TEXTURE_2D texture to the active unit
+	static void bindTexture(unsigned int texture);
+	static void bindVertexArray(unsigned int vertex_array);
+	static void bindFramebuffer(unsigned int framebuffer);
+
+	// forget a deleted object so that a new object with the same name gets bound
+	static void forgetProgram(unsigned int program);
+	static void forgetTexture(unsigned int texture);
+	static void forgetVertexArray(unsigned int vertex_array);
+	static void forgetFramebuffer(unsigned int framebuffer);
+	// forget everything, the next bind of every object is issued
+	static void invalidate();
+
+	static const Counters& getCounters() { return counters; }
+	static void resetCounters() { counters = Counters(); }
+private:
+	// private constructor, all the state is static like in ResourceManager
+	RenderState() {}
+	// ~0u marks unknown state
+	static unsigned int program;
+	static unsigned int active_unit;
+	static unsigned int textures[MAX_TEXTURE_UNITS];
+	static unsigned int vertex_array;
+	static unsigned int framebuffer;
+	static Counters counters;
+
+	// updates the cached binding, returns true if the GL call has to be issued
+	static bool update(unsigned int& current, unsigned int value);
+};
+
+#endif
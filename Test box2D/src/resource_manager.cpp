@@ -1,8 +1,22 @@
 #include "resource_manager.h"
+#include "render_state.h"
+#include "thread_pool.h"
+#include "program_binary.h"
+#include "binary_io.h"
+#include "file_watcher.h"
+#include "frame_arena.h"
 
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <deque>
+#include <filesystem>
 #include <iostream>
-#include <sstream>
 #include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
 #ifndef STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
@@ -11,9 +25,273 @@
 // instantiate static variables
 std::map<std::string, Shader> ResourceManager::shaders;
 std::map<std::string, Texture2D> ResourceManager::textures;
+TextureAtlas ResourceManager::atlas;
+
+namespace {
+	// decoding is mostly waiting on stb_image, a couple of threads keep the cores free
+	// for the simulation thread
+	const unsigned int LOADER_THREADS = 2;
+
+	// image decoded by a loader thread, waiting for its upload on the GL thread
+	struct DecodedImage {
+		std::string name;
+		std::string file;
+		int width = 0, height = 0;
+		bool alpha = false;
+		bool atlas = false; // packed in the atlas instead of getting its own texture
+		std::vector<unsigned char> pixels; // empty if the decode failed
+	};
+
+	// state of the asynchronous loads. The pool is declared last so that its threads
+	// are joined before the queue they write to is destroyed
+	struct AsyncLoader {
+		std::mutex mutex;
+		std::vector<DecodedImage> decoded; // written by the loader threads, under mutex
+		std::deque<DecodedImage> ready; // taken from decoded, GL thread only
+		unsigned int pending = 0; // loads queued and not uploaded yet
+		unsigned int pending_atlas = 0; // atlas images among them
+		std::vector<std::string> atlas_names; // atlas images waiting for the atlas build
+		std::unique_ptr<Texture2D> placeholder;
+		GLuint upload_buffer = 0; // pixel buffer object the uploads are staged in
+		std::unique_ptr<ThreadPool> pool;
+	} loader;
+
+	// uploads the pixels through the pixel buffer object: glTexImage2D sources them from
+	// the buffer, so the driver does not have to copy them out of client memory first
+	void uploadTexture(Texture2D& texture, unsigned int width, unsigned int height, const std::vector<unsigned char>& pixels) {
+		size_t size = pixels.size();
+		if (loader.upload_buffer == 0)
+			glGenBuffers(1, &loader.upload_buffer);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, loader.upload_buffer);
+		// orphan the previous storage, the last upload may still be reading it
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+		void* staging = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		if (staging != nullptr) {
+			std::memcpy(staging, pixels.data(), size);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			// with a pixel unpack buffer bound, the data pointer is an offset in the buffer
+			texture.generate(width, height, nullptr);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		}
+		else {
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			texture.generate(width, height, const_cast<unsigned char*>(pixels.data()));
+		}
+	}
+
+	// files behind the named resources, for hot reload
+	struct ShaderFiles {
+		std::string vertex, fragment, geometry; // geometry is empty if there is none
+	};
+	struct TextureFile {
+		std::string file;
+		bool alpha;
+	};
+	struct HotReload {
+		std::map<std::string, ShaderFiles> shaders;
+		std::map<std::string, TextureFile> textures;
+		std::map<std::string, std::string> atlas_images;
+		std::unique_ptr<FileWatcher> watcher; // only once enabled
+	} hot_reload;
+
+	// transient strings of the loaders (shader sources and cache paths), reset at the start
+	// of every load. Loads run on the GL thread only
+	FrameArena loader_arena(64 * 1024);
+
+	void watchFile(const std::string& file) {
+		if (hot_reload.watcher)
+			hot_reload.watcher->watch(file);
+	}
+
+	// linked programs are kept across runs in this directory, one file per program
+	const char* PROGRAM_CACHE_DIRECTORY = "shaders cache";
+	// program cache file: "E2DP", version, binary format, binary length, then the binary
+	const char PROGRAM_CACHE_MAGIC[4] = { 'E', '2', 'D', 'P' };
+	const uint32_t PROGRAM_CACHE_VERSION = 1;
+	const size_t PROGRAM_CACHE_HEADER_SIZE = 16;
+
+	// 64-bit FNV-1a, chained through hash
+	uint64_t hashBytes(const char* data, size_t size, uint64_t hash = 14695981039346656037ull) {
+		for (size_t i = 0; i < size; i++) {
+			hash ^= static_cast<unsigned char>(data[i]);
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	// cache file of the program linked from these sources. The driver strings are part of
+	// the key, a driver update makes the old binaries unreachable instead of failing to load.
+	// Returns an empty path if the driver can't save program binaries
+	FrameString getProgramCachePath(const FrameString& vertex_code, const FrameString& fragment_code, const FrameString& geometry_code) {
+		FrameString path(loader_arena);
+		if (!ProgramBinary::isSupported())
+			return path;
+		uint64_t hash = 14695981039346656037ull;
+		// the terminating zeros separate the strings, so that moving text from one
+		// source to the next changes the key
+		for (const FrameString* source : { &vertex_code, &fragment_code, &geometry_code })
+			hash = hashBytes(source->c_str(), source->size() + 1, hash);
+		for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+			const char* text = reinterpret_cast<const char*>(glGetString(name));
+			if (text != nullptr)
+				hash = hashBytes(text, std::strlen(text) + 1, hash);
+		}
+		char file_name[32];
+		std::snprintf(file_name, sizeof(file_name), "%016llx.bin", static_cast<unsigned long long>(hash));
+		path.append(PROGRAM_CACHE_DIRECTORY).append("/").append(file_name);
+		return path;
+	}
+
+	bool loadCachedProgram(Shader& shader, const FrameString& path) {
+		std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
+		if (!file)
+			return false;
+		std::streamoff size = file.tellg();
+		if (size < static_cast<std::streamoff>(PROGRAM_CACHE_HEADER_SIZE))
+			return false;
+		// a local buffer, not the loader arena: the arena would keep a block as large as
+		// the largest cache file ever loaded
+		std::vector<unsigned char> data(static_cast<size_t>(size));
+		file.seekg(0);
+		if (!file.read(reinterpret_cast<char*>(data.data()), size))
+			return false;
+		uint32_t length = getU32(&data[12]);
+		if (std::memcmp(data.data(), PROGRAM_CACHE_MAGIC, 4) != 0 || getU32(&data[4]) != PROGRAM_CACHE_VERSION
+			|| length != data.size() - PROGRAM_CACHE_HEADER_SIZE)
+			return false;
+		return shader.loadBinary(getU32(&data[8]), &data[PROGRAM_CACHE_HEADER_SIZE], static_cast<int>(length));
+	}
+
+	void saveCachedProgram(const Shader& shader, const FrameString& path) {
+		GLenum format;
+		std::vector<unsigned char> binary;
+		if (!ProgramBinary::retrieve(shader.ID, &format, &binary))
+			return;
+		std::error_code error;
+		std::filesystem::create_directories(PROGRAM_CACHE_DIRECTORY, error);
+		unsigned char header[PROGRAM_CACHE_HEADER_SIZE];
+		std::memcpy(header, PROGRAM_CACHE_MAGIC, 4);
+		putU32(&header[4], PROGRAM_CACHE_VERSION);
+		putU32(&header[8], format);
+		putU32(&header[12], static_cast<uint32_t>(binary.size()));
+		std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(binary.data()), binary.size());
+		if (!file)
+			std::cout << "ERROR::SHADER: Failed to write the program cache " << path << std::endl;
+	}
+
+	// block-compressed textures are kept across runs in this directory, one file per texture
+	const char* TEXTURE_CACHE_DIRECTORY = "textures cache";
+	// texture cache file: "E2DT", version, format, width, height, level count, then every
+	// mip level as its size followed by its blocks
+	const char TEXTURE_CACHE_MAGIC[4] = { 'E', '2', 'D', 'T' };
+	const uint32_t TEXTURE_CACHE_VERSION = 1;
+	const size_t TEXTURE_CACHE_HEADER_SIZE = 24;
+
+	// cache file of an image compressed to format. The size and modification time of the
+	// image are part of the key, so an edited image is compressed again
+	FrameString getTextureCachePath(const char* file, GLenum format) {
+		FrameString path(loader_arena);
+		std::error_code error;
+		uintmax_t size = std::filesystem::file_size(file, error);
+		if (error)
+			return path;
+		auto modified = std::filesystem::last_write_time(file, error).time_since_epoch().count();
+		if (error)
+			return path;
+		char numbers[80];
+		const int length = std::snprintf(numbers, sizeof(numbers), "%llu%c%lld%c%u", static_cast<unsigned long long>(size), '\0',
+			static_cast<long long>(modified), '\0', static_cast<unsigned int>(format));
+		FrameString key(file, loader_arena);
+		key.push_back('\0');
+		key.append(numbers, length);
+		char file_name[32];
+		std::snprintf(file_name, sizeof(file_name), "%016llx.bin", static_cast<unsigned long long>(hashBytes(key.data(), key.size())));
+		path.append(TEXTURE_CACHE_DIRECTORY).append("/").append(file_name);
+		return path;
+	}
+
+	bool loadCachedTexture(Texture2D& texture, const FrameString& path) {
+		std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
+		if (!file)
+			return false;
+		std::streamoff size = file.tellg();
+		if (size < static_cast<std::streamoff>(TEXTURE_CACHE_HEADER_SIZE))
+			return false;
+		std::vector<unsigned char> data(static_cast<size_t>(size));
+		file.seekg(0);
+		if (!file.read(reinterpret_cast<char*>(data.data()), size))
+			return false;
+		if (std::memcmp(data.data(), TEXTURE_CACHE_MAGIC, 4) != 0 || getU32(&data[4]) != TEXTURE_CACHE_VERSION
+			|| getU32(&data[8]) != texture.internal_format)
+			return false;
+		uint32_t width = getU32(&data[12]), height = getU32(&data[16]), level_count = getU32(&data[20]);
+		if (level_count == 0 || level_count > Texture2D::getLevelCount(width, height))
+			return false;
+		std::vector<std::vector<unsigned char>> levels(level_count);
+		size_t offset = TEXTURE_CACHE_HEADER_SIZE;
+		for (auto& level : levels) {
+			if (offset + 4 > data.size())
+				return false;
+			uint32_t level_size = getU32(&data[offset]);
+			offset += 4;
+			if (level_size == 0 || level_size > data.size() - offset)
+				return false;
+			level.assign(&data[offset], &data[offset] + level_size);
+			offset += level_size;
+		}
+		texture.generateCompressed(width, height, texture.internal_format, levels);
+		return true;
+	}
+
+	void saveCachedTexture(const Texture2D& texture, const FrameString& path) {
+		std::vector<std::vector<unsigned char>> levels;
+		if (!texture.getCompressedLevels(levels))
+			return;
+		std::error_code error;
+		std::filesystem::create_directories(TEXTURE_CACHE_DIRECTORY, error);
+		unsigned char header[TEXTURE_CACHE_HEADER_SIZE];
+		std::memcpy(header, TEXTURE_CACHE_MAGIC, 4);
+		putU32(&header[4], TEXTURE_CACHE_VERSION);
+		putU32(&header[8], texture.internal_format);
+		putU32(&header[12], texture.width);
+		putU32(&header[16], texture.height);
+		putU32(&header[20], static_cast<uint32_t>(levels.size()));
+		std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(header), sizeof(header));
+		for (const auto& level : levels) {
+			unsigned char level_size[4];
+			putU32(level_size, static_cast<uint32_t>(level.size()));
+			file.write(reinterpret_cast<const char*>(level_size), sizeof(level_size));
+			file.write(reinterpret_cast<const char*>(level.data()), level.size());
+		}
+		if (!file)
+			std::cout << "ERROR::TEXTURE: Failed to write the texture cache " << path << std::endl;
+	}
+
+	// reads a whole file with a single allocation, in the loader arena
+	bool readTextFile(const char* path, FrameString& text) {
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file)
+			return false;
+		std::streamoff size = file.tellg();
+		text.resize(static_cast<size_t>(size));
+		file.seekg(0);
+		return static_cast<bool>(file.read(&text[0], size));
+	}
+}
 
 Shader ResourceManager::loadShader(const char* v_shader_file, const char* f_shader_file, const char* g_shader_file, std::string name) {
 	shaders[name] = loadShaderFromFile(v_shader_file, f_shader_file, g_shader_file);
+	ShaderFiles& files = hot_reload.shaders[name];
+	files.vertex = v_shader_file;
+	files.fragment = f_shader_file;
+	files.geometry = g_shader_file != nullptr ? g_shader_file : "";
+	watchFile(files.vertex);
+	watchFile(files.fragment);
+	if (!files.geometry.empty())
+		watchFile(files.geometry);
 	return shaders[name];
 }
 
@@ -23,6 +301,8 @@ Shader& ResourceManager::getShader(std::string name) {
 
 Texture2D ResourceManager::loadTexture(const char* file, bool alpha, std::string name) {
 	textures[name] = loadTextureFromFile(file, alpha);
+	hot_reload.textures[name] = { file, alpha };
+	watchFile(file);
 	return textures[name];
 }
 
@@ -30,52 +310,234 @@ Texture2D& ResourceManager::getTexture(std::string name) {
 	return textures[name];
 }
 
+void ResourceManager::loadAtlasTexture(const char* file, std::string name) {
+	// atlas pages are RGBA, so every image is expanded to four channels
+	int width, height, nr_channels;
+	unsigned char* data = stbi_load(file, &width, &height, &nr_channels, 4);
+	if (data == nullptr) {
+		std::cout << "ERROR::TEXTURE: Failed to load " << file << std::endl;
+		return;
+	}
+	atlas.addImage(name, width, height, data);
+	stbi_image_free(data);
+	hot_reload.atlas_images[name] = file;
+	watchFile(file);
+}
+
+void ResourceManager::buildAtlas() {
+	atlas.build();
+}
+
+void ResourceManager::loadTextureAsync(const char* file, bool alpha, std::string name) {
+	textures.insert_or_assign(name, getPlaceholder());
+	queueDecode(file, alpha, false, name);
+	hot_reload.textures[name] = { file, alpha };
+	watchFile(file);
+}
+
+void ResourceManager::loadAtlasTextureAsync(const char* file, std::string name) {
+	// the placeholder is what getTextureRegion falls back to until the atlas is built
+	textures.insert_or_assign(name, getPlaceholder());
+	loader.atlas_names.push_back(name);
+	loader.pending_atlas++;
+	queueDecode(file, true, true, name);
+	hot_reload.atlas_images[name] = file;
+	watchFile(file);
+}
+
+bool ResourceManager::processUploads(float budget_ms) {
+	if (loader.pending == 0 && atlas.getStagedPageCount() == 0)
+		return false;
+	const auto start = std::chrono::steady_clock::now();
+	{
+		std::lock_guard<std::mutex> lock(loader.mutex);
+		for (DecodedImage& image : loader.decoded)
+			loader.ready.push_back(std::move(image));
+		loader.decoded.clear();
+	}
+
+	// one decoded image or one atlas page per iteration, the pages once all the atlas
+	// images are in and packed
+	bool changed = false;
+	while (!loader.ready.empty() || atlas.getStagedPageCount() > 0) {
+		if (!loader.ready.empty()) {
+			DecodedImage& image = loader.ready.front();
+			if (image.pixels.empty()) {
+				// the name keeps the placeholder
+				std::cout << "ERROR::TEXTURE: Failed to load " << image.file << std::endl;
+			}
+			else if (image.atlas) {
+				atlas.addImage(image.name, image.width, image.height, std::move(image.pixels));
+			}
+			else {
+				Texture2D texture;
+				if (image.alpha) {
+					texture.internal_format = GL_RGBA;
+					texture.image_format = GL_RGBA;
+				}
+				texture.mipmaps = true;
+				uploadTexture(texture, image.width, image.height, image.pixels);
+				textures.insert_or_assign(image.name, texture);
+				changed = true;
+			}
+			if (image.atlas && --loader.pending_atlas == 0)
+				atlas.pack();
+			loader.ready.pop_front();
+			loader.pending--;
+		}
+		else {
+			atlas.uploadStagedPage([](Texture2D& page, std::vector<unsigned char>& pixels) {
+				uploadTexture(page, page.width, page.height, pixels);
+			});
+		}
+		if (!loader.atlas_names.empty() && loader.pending_atlas == 0 && atlas.getStagedPageCount() == 0) {
+			// every page is up, drop the placeholders of the packed images
+			TextureRegion region;
+			for (const std::string& name : loader.atlas_names) {
+				auto it = textures.find(name);
+				if (atlas.getRegion(name, &region) && it != textures.end() && it->second.ID == loader.placeholder->ID)
+					textures.erase(it);
+			}
+			loader.atlas_names.clear();
+			changed = true;
+		}
+		if (std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count() >= budget_ms)
+			break;
+	}
+	return changed;
+}
+
+unsigned int ResourceManager::getPendingLoads() {
+	return loader.pending + atlas.getStagedPageCount();
+}
+
+void ResourceManager::enableHotReload() {
+	if (hot_reload.watcher)
+		return;
+	hot_reload.watcher = std::make_unique<FileWatcher>();
+	for (const auto& shader : hot_reload.shaders) {
+		watchFile(shader.second.vertex);
+		watchFile(shader.second.fragment);
+		if (!shader.second.geometry.empty())
+			watchFile(shader.second.geometry);
+	}
+	for (const auto& texture : hot_reload.textures)
+		watchFile(texture.second.file);
+	for (const auto& image : hot_reload.atlas_images)
+		watchFile(image.second);
+}
+
+bool ResourceManager::processReloads() {
+	if (!hot_reload.watcher)
+		return false;
+	std::vector<std::string> changed;
+	hot_reload.watcher->poll(changed);
+	bool ids_changed = false;
+	for (const std::string& file : changed) {
+		for (const auto& entry : hot_reload.shaders) {
+			const ShaderFiles& files = entry.second;
+			if (file != files.vertex && file != files.fragment && file != files.geometry)
+				continue;
+			loader_arena.reset();
+			FrameString vertex_code(loader_arena), fragment_code(loader_arena), geometry_code(loader_arena);
+			bool read = readTextFile(files.vertex.c_str(), vertex_code) && readTextFile(files.fragment.c_str(), fragment_code)
+				&& (files.geometry.empty() || readTextFile(files.geometry.c_str(), geometry_code));
+			if (!read || !shaders[entry.first].reload(vertex_code.c_str(), fragment_code.c_str(), files.geometry.empty() ? nullptr : geometry_code.c_str()))
+				std::cout << "ERROR::SHADER: Failed to reload " << entry.first << ", keeping the previous program" << std::endl;
+		}
+		for (const auto& entry : hot_reload.textures) {
+			auto texture = textures.find(entry.first);
+			// a load still in flight delivers the new image anyway
+			if (entry.second.file != file || texture == textures.end() || (loader.placeholder && texture->second.ID == loader.placeholder->ID))
+				continue;
+			int width, height, nr_channels;
+			unsigned char* data = stbi_load(file.c_str(), &width, &height, &nr_channels, entry.second.alpha ? 4 : 3);
+			if (data == nullptr) {
+				std::cout << "ERROR::TEXTURE: Failed to reload " << file << std::endl;
+				continue;
+			}
+			if (!texture->second.update(width, height, data))
+				ids_changed = true;
+			stbi_image_free(data);
+		}
+		for (const auto& entry : hot_reload.atlas_images) {
+			if (entry.second != file)
+				continue;
+			int width, height, nr_channels;
+			unsigned char* data = stbi_load(file.c_str(), &width, &height, &nr_channels, 4);
+			if (data == nullptr || !atlas.updateImage(entry.first, width, height, data))
+				std::cout << "ERROR::ATLAS: Failed to reload " << file << ", atlas images can only be replaced by images of the same size" << std::endl;
+			stbi_image_free(data);
+		}
+	}
+	return ids_changed;
+}
+
+TextureRegion ResourceManager::getTextureRegion(std::string name) {
+	TextureRegion region;
+	if (!atlas.getRegion(name, &region))
+		region.texture_ID = textures[name].ID;
+	return region;
+}
+
 void ResourceManager::clear() {
+	// let the decodes in flight finish, their images are dropped
+	if (loader.pool)
+		loader.pool->wait();
+	loader.decoded.clear();
+	loader.ready.clear();
+	loader.atlas_names.clear();
+	loader.pending = 0;
+	loader.pending_atlas = 0;
+	hot_reload.shaders.clear();
+	hot_reload.textures.clear();
+	hot_reload.atlas_images.clear();
+	if (loader.upload_buffer != 0) {
+		glDeleteBuffers(1, &loader.upload_buffer);
+		loader.upload_buffer = 0;
+	}
 	// (properly) delete all shaders
-	for (auto iter : shaders)
-		glDeleteProgram(iter.second.ID);
-	// (properly) delete all textures
-	for (auto iter : textures)
+	for (auto iter : shaders) {
 		glDeleteProgram(iter.second.ID);
+		RenderState::forgetProgram(iter.second.ID);
+	}
+	// (properly) delete all textures, the placeholder shared by pending loads only once
+	for (auto iter : textures) {
+		if (loader.placeholder && iter.second.ID == loader.placeholder->ID)
+			continue;
+		glDeleteTextures(1, &iter.second.ID);
+		RenderState::forgetTexture(iter.second.ID);
+	}
+	if (loader.placeholder) {
+		glDeleteTextures(1, &loader.placeholder->ID);
+		RenderState::forgetTexture(loader.placeholder->ID);
+		loader.placeholder.reset();
+	}
+	atlas.clear();
 }
 
 Shader ResourceManager::loadShaderFromFile(const char* v_shader_file, const char* f_shader_file, const char* g_shader_file) {
 	// 1. retrieve the vertex/fragment source code from filePath
-	std::string vertex_code;
-	std::string fragment_code;
-	std::string geometry_code;
-	try {
-		// open files
-		std::ifstream vertex_shader_file(v_shader_file);
-		std::ifstream fragment_shader_file(f_shader_file);
-		std::stringstream v_shader_stream, f_shader_stream;
-		// read file's buffer contents into streams
-		v_shader_stream << vertex_shader_file.rdbuf();
-		f_shader_stream << fragment_shader_file.rdbuf();
-		// close file handlers
-		vertex_shader_file.close();
-		fragment_shader_file.close();
-		// convert stream into string
-		vertex_code = v_shader_stream.str();
-		fragment_code = f_shader_stream.str();
-		// if geometry shader path is present, also load geometry shader
-		if (g_shader_file != nullptr) {
-			std::ifstream geometry_shader_file(g_shader_file);
-			std::stringstream g_shader_stream;
-			g_shader_stream << geometry_shader_file.rdbuf();
-			geometry_shader_file.close();
-			geometry_code = g_shader_stream.str();
-		}
-	}
-	catch (std::exception e) {
+	loader_arena.reset();
+	FrameString vertex_code(loader_arena);
+	FrameString fragment_code(loader_arena);
+	FrameString geometry_code(loader_arena);
+	// the geometry shader is only read if its path is present
+	if (!readTextFile(v_shader_file, vertex_code) || !readTextFile(f_shader_file, fragment_code)
+		|| (g_shader_file != nullptr && !readTextFile(g_shader_file, geometry_code)))
 		std::cout << "ERROR:SHADER: Failed to read shader files" << std::endl;
-	}
 	const char* v_shader_code = vertex_code.c_str();
 	const char* f_shader_code = fragment_code.c_str();
 	const char* g_shader_code = geometry_code.c_str();
-	// 2. now create shader object from source code
+	// 2. reuse the program linked by a previous run, otherwise create shader object from
+	// source code and cache the linked program for the next run
 	Shader shader;
-	shader.compile(v_shader_code, f_shader_code, g_shader_file != nullptr ? g_shader_code : nullptr);
+	FrameString cache_path = getProgramCachePath(vertex_code, fragment_code, geometry_code);
+	if (cache_path.empty() || !loadCachedProgram(shader, cache_path)) {
+		shader.compile(v_shader_code, f_shader_code, g_shader_file != nullptr ? g_shader_code : nullptr);
+		if (!cache_path.empty())
+			saveCachedProgram(shader, cache_path);
+	}
 	return shader;
 }
 
@@ -86,12 +548,62 @@ Texture2D ResourceManager::loadTextureFromFile(const char* file, bool alpha) {
 		texture.internal_format = GL_RGBA;
 		texture.image_format = GL_RGBA;
 	}
+	texture.mipmaps = true;
+	// block-compressed when the driver can: an image compressed by a previous run is
+	// uploaded as is, without decoding it
+	loader_arena.reset();
+	FrameString cache_path(loader_arena);
+	if (Texture2D::isCompressionSupported()) {
+		texture.internal_format = alpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		cache_path = getTextureCachePath(file, texture.internal_format);
+		if (!cache_path.empty() && loadCachedTexture(texture, cache_path))
+			return texture;
+	}
 	// load image
 	int width, height, nr_channels;
-	unsigned char* data = stbi_load(file, &width, &height, &nr_channels, 0);
+	unsigned char* data = stbi_load(file, &width, &height, &nr_channels, alpha ? 4 : 3);
+	if (data == nullptr) {
+		std::cout << "ERROR::TEXTURE: Failed to load " << file << std::endl;
+		return texture;
+	}
 	// generate texture
 	texture.generate(width, height, data);
 	// free image data
 	stbi_image_free(data);
+	if (!cache_path.empty())
+		saveCachedTexture(texture, cache_path);
 	return texture;
+}
+
+const Texture2D& ResourceManager::getPlaceholder() {
+	if (!loader.placeholder) {
+		const unsigned char white[4] = { 255, 255, 255, 255 };
+		loader.placeholder = std::make_unique<Texture2D>();
+		loader.placeholder->internal_format = GL_RGBA;
+		loader.placeholder->image_format = GL_RGBA;
+		loader.placeholder->generate(1, 1, const_cast<unsigned char*>(white));
+	}
+	return *loader.placeholder;
+}
+
+void ResourceManager::queueDecode(const char* file, bool alpha, bool atlas, const std::string& name) {
+	if (!loader.pool)
+		loader.pool = std::make_unique<ThreadPool>(LOADER_THREADS);
+	loader.pending++;
+	DecodedImage request;
+	request.name = name;
+	request.file = file;
+	request.alpha = alpha;
+	request.atlas = atlas;
+	loader.pool->enqueue([request]() mutable {
+		// stbi_load is reentrant as long as the flip and conversion globals are not changed
+		int nr_channels;
+		unsigned char* data = stbi_load(request.file.c_str(), &request.width, &request.height, &nr_channels, request.alpha ? 4 : 3);
+		if (data != nullptr) {
+			request.pixels.assign(data, data + static_cast<size_t>(request.width) * request.height * (request.alpha ? 4 : 3));
+			stbi_image_free(data);
+		}
+		std::lock_guard<std::mutex> lock(loader.mutex);
+		loader.decoded.push_back(std::move(request));
+	});
 }
\ No newline at end of file
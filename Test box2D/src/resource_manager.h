@@ -7,6 +7,7 @@
 #include<glad/glad.h>
 
 #include "texture.h"
+#include "texture_atlas.h"
 #include "sprite_renderer.h"
 #include "shader.hpp"
 
@@ -21,6 +22,7 @@ public:
 	// resource storage
 	static std::map<std::string, Shader> shaders;
 	static std::map<std::string, Texture2D> textures;
+	static TextureAtlas atlas;
 
 	// loads (and generates) a shader program from file loading
 	// vertex, fragment (and geometry) shader's source code.
@@ -32,6 +34,34 @@ public:
 	static Texture2D loadTexture(const char* file, bool alpha, std::string name);
 	// retrieves a stored texture
 	static Texture2D& getTexture(std::string name);
+	// loads an image from file and queues it for packing in the texture atlas
+	static void loadAtlasTexture(const char* file, std::string name);
+	// packs all the queued images into the atlas textures
+	static void buildAtlas();
+	// asynchronous loading: the image is decoded by a loader thread and uploaded later by
+	// processUploads(). Until then the name resolves to a 1x1 white placeholder texture
+	static void loadTextureAsync(const char* file, bool alpha, std::string name);
+	// same for an atlas image. The atlas is packed as soon as all its queued images are
+	// decoded and its pages are uploaded like the images, buildAtlas() does not have to
+	// be called
+	static void loadAtlasTextureAsync(const char* file, std::string name);
+	// uploads the decoded images and the atlas pages on the GL thread, until budget_ms
+	// milliseconds are spent. At least one image or page is uploaded per call. Returns true
+	// if a texture or region changed, in which case copies of them taken before must be
+	// retrieved again
+	static bool processUploads(float budget_ms);
+	// number of asynchronous loads and atlas pages not uploaded yet
+	static unsigned int getPendingLoads();
+	// hot reload: starts watching the files of the shaders and textures loaded so far and
+	// from now on
+	static void enableHotReload();
+	// reloads in place the shaders and textures whose files changed. Shaders that fail to
+	// compile keep their previous program. Returns true if a texture got a new ID, in which
+	// case copies of the textures and regions taken before must be retrieved again
+	static bool processReloads();
+	// retrieves the region of a texture: its sub-rectangle if it was packed in the
+	// atlas, otherwise the whole stored texture
+	static TextureRegion getTextureRegion(std::string name);
 	// properly de-allocates all loaded resources
 	static void clear(); 
 private:
@@ -42,6 +72,10 @@ private:
 	static Shader loadShaderFromFile(const char* vShaderFile, const char* fShaderFile, const char* gShaderFile);
 	// loads a single texture from file
 	static Texture2D loadTextureFromFile(const char* file, bool alpha);
+	// the texture pending asynchronous loads resolve to, created on first use
+	static const Texture2D& getPlaceholder();
+	// queues the decode of an image on the loader threads
+	static void queueDecode(const char* file, bool alpha, bool atlas, const std::string& name);
 };
 
 
@@ -0,0 +1,164 @@
+#include "scene_file.h"
+
+#include <cstring>
+#include <fstream>
+#include <map>
+#include "binary_io.h"
+#include "mapped_file.h"
+
+static void encodeRecord(const SceneShapeRecord& record, unsigned char* out)
+{
+    std::memset(out, 0, SCENE_RECORD_SIZE);
+    out[0] = record.group;
+    out[1] = record.body_type;
+    putU32(out + 4, record.name_offset);
+    putF32(out + 8, record.p1[0]);
+    putF32(out + 12, record.p1[1]);
+    putF32(out + 16, record.p2[0]);
+    putF32(out + 20, record.p2[1]);
+    for (int i = 0; i < 4; i++)
+        putF32(out + 24 + 4 * i, record.color[i]);
+    putF32(out + 40, record.area);
+    putF32(out + 44, record.rotation);
+}
+
+static void decodeRecord(const unsigned char* in, SceneShapeRecord* record)
+{
+    record->group = in[0];
+    record->body_type = in[1];
+    record->name_offset = getU32(in + 4);
+    record->p1[0] = getF32(in + 8);
+    record->p1[1] = getF32(in + 12);
+    record->p2[0] = getF32(in + 16);
+    record->p2[1] = getF32(in + 20);
+    for (int i = 0; i < 4; i++)
+        record->color[i] = getF32(in + 24 + 4 * i);
+    record->area = getF32(in + 40);
+    record->rotation = getF32(in + 44);
+}
+
+bool isSceneFile(const std::string& filePath)
+{
+    std::ifstream infile(filePath, std::ios_base::in | std::ios_base::binary);
+    char magic[4];
+    return infile.read(magic, sizeof(magic)) && std::memcmp(magic, SCENE_MAGIC, sizeof(magic)) == 0;
+}
+
+bool saveSceneFile(const std::string& filePath, const CanvasShapes& shapes)
+{
+    // names are deduplicated in the string table
+    std::string strings;
+    std::map<std::string, uint32_t> name_offsets;
+    uint32_t shape_count = 0;
+    for (auto& group : shapes)
+    {
+        for (auto& shape : group.second)
+        {
+            if (name_offsets.find(shape.name) == name_offsets.end())
+            {
+                name_offsets[shape.name] = static_cast<uint32_t>(strings.size());
+                strings += shape.name;
+                strings += '\0';
+            }
+            shape_count++;
+        }
+    }
+
+    std::vector<unsigned char> buffer(SCENE_HEADER_SIZE + static_cast<size_t>(shape_count) * SCENE_RECORD_SIZE + strings.size(), 0);
+    unsigned char* header = buffer.data();
+    std::memcpy(header, SCENE_MAGIC, sizeof(SCENE_MAGIC));
+    putU32(header + 4, SCENE_VERSION);
+    putU32(header + 8, shape_count);
+    putU32(header + 12, SCENE_RECORD_SIZE);
+    putU32(header + 16, SCENE_HEADER_SIZE + shape_count * SCENE_RECORD_SIZE);
+    putU32(header + 20, static_cast<uint32_t>(strings.size()));
+
+    unsigned char* out = buffer.data() + SCENE_HEADER_SIZE;
+    for (auto& group : shapes)
+    {
+        for (auto& shape : group.second)
+        {
+            SceneShapeRecord record{};
+            record.group = static_cast<uint8_t>(group.first);
+            record.body_type = static_cast<uint8_t>(shape.type);
+            record.name_offset = name_offsets[shape.name];
+            record.p1[0] = shape.p1.x;
+            record.p1[1] = shape.p1.y;
+            record.p2[0] = shape.p2.x;
+            record.p2[1] = shape.p2.y;
+            record.color[0] = shape.color.x;
+            record.color[1] = shape.color.y;
+            record.color[2] = shape.color.z;
+            record.color[3] = shape.color.w;
+            record.area = shape.area;
+            record.rotation = shape.rotation;
+            encodeRecord(record, out);
+            out += SCENE_RECORD_SIZE;
+        }
+    }
+    std::memcpy(out, strings.data(), strings.size());
+
+    std::ofstream outfile(filePath, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+    if (!outfile.is_open())
+        return false;
+    outfile.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+    return static_cast<bool>(outfile);
+}
+
+bool loadSceneFile(const std::string& filePath, CanvasShapes* shapes)
+{
+    MappedFile file;
+    if (!file.open(filePath) || file.size() < SCENE_HEADER_SIZE)
+        return false;
+
+    const unsigned char* data = file.data();
+    if (std::memcmp(data, SCENE_MAGIC, sizeof(SCENE_MAGIC)) != 0 || getU32(data + 4) != SCENE_VERSION)
+        return false;
+    const uint32_t shape_count = getU32(data + 8);
+    const uint32_t record_size = getU32(data + 12);
+    const uint32_t strings_offset = getU32(data + 16);
+    const uint32_t strings_size = getU32(data + 20);
+    // newer minor revisions may append fields to the records, so only a minimum size is required
+    if (record_size < SCENE_RECORD_SIZE ||
+        SCENE_HEADER_SIZE + static_cast<uint64_t>(shape_count) * record_size > strings_offset ||
+        static_cast<uint64_t>(strings_offset) + strings_size > file.size() ||
+        (strings_size > 0 && data[strings_offset + strings_size - 1] != '\0'))
+        return false;
+    const char* strings = reinterpret_cast<const char*>(data + strings_offset);
+
+    // decoded into a separate canva, the shapes are only replaced once the whole file is valid
+    CanvasShapes loaded;
+    // size every group up front so that filling it does not reallocate
+    uint32_t group_counts[256] = {};
+    for (uint32_t i = 0; i < shape_count; i++)
+        group_counts[data[SCENE_HEADER_SIZE + static_cast<size_t>(i) * record_size]]++;
+    for (int group = 0; group < 256; group++)
+        if (group_counts[group] > 0)
+            loaded[group].reserve(group_counts[group]);
+
+    SceneShapeRecord record;
+    for (uint32_t i = 0; i < shape_count; i++)
+    {
+        decodeRecord(data + SCENE_HEADER_SIZE + static_cast<size_t>(i) * record_size, &record);
+        if (record.name_offset >= strings_size)
+            return false;
+        Shape_t shape;
+        shape.name = strings + record.name_offset;
+        shape.p1 = ImVec2(record.p1[0], record.p1[1]);
+        shape.p2 = ImVec2(record.p2[0], record.p2[1]);
+        shape.color = ImVec4(record.color[0], record.color[1], record.color[2], record.color[3]);
+        shape.type = static_cast<b2BodyType>(record.body_type);
+        shape.area = record.area;
+        shape.rotation = record.rotation;
+        loaded[record.group].push_back(shape);
+    }
+    shapes->swap(loaded);
+    return true;
+}
+
+bool loadScene(const std::string& filePath, CanvasShapes* shapes)
+{
+    if (isSceneFile(filePath))
+        return loadSceneFile(filePath, shapes);
+    return loadCanvasFile(filePath, shapes);
+}
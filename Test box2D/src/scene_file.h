@@ -0,0 +1,46 @@
+#ifndef SCENE_FILE_H
+#define SCENE_FILE_H
+
+#include <cstdint>
+#include <string>
+#include "canvas.h"
+
+// Binary scene format, all values little-endian:
+//
+//   header      SCENE_HEADER_SIZE bytes: magic "E2DS", version, shape count, record size,
+//               string table offset and size, two reserved words
+//   shape table shape count records of SCENE_RECORD_SIZE bytes, see SceneShapeRecord
+//   strings     null-terminated shape names, referenced by offset from the records
+//
+// Loading maps the file and decodes the fixed-size records in place, so no memory
+// is allocated per shape beyond the canvas storage itself.
+
+const char SCENE_MAGIC[4] = { 'E', '2', 'D', 'S' };
+const uint32_t SCENE_VERSION = 1;
+const uint32_t SCENE_HEADER_SIZE = 32;
+const uint32_t SCENE_RECORD_SIZE = 48;
+
+// one shape of the canva as stored in the shape table
+struct SceneShapeRecord {
+    uint8_t group; // canvas kind: 0 line, 1 rectangle, 2 circle
+    uint8_t body_type; // b2BodyType
+    uint16_t reserved;
+    uint32_t name_offset; // offset of the name in the string table
+    float p1[2];
+    float p2[2];
+    float color[4];
+    float area;
+    float rotation;
+};
+
+// returns true if the file starts with the binary scene magic
+bool isSceneFile(const std::string& filePath);
+// saves the canva in the binary scene format. Returns false if the file can't be written
+bool saveSceneFile(const std::string& filePath, const CanvasShapes& shapes);
+// loads a binary scene file into the canva. Returns false if the file is missing or malformed,
+// in which case the canva is left unchanged
+bool loadSceneFile(const std::string& filePath, CanvasShapes* shapes);
+// loads either format: binary scene files directly, anything else through the text canvas importer
+bool loadScene(const std::string& filePath, CanvasShapes* shapes);
+
+#endif
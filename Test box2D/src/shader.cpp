@@ -1,29 +1,35 @@
 #include <iostream>
+#include <cstring>
 #include "shader.hpp"
+#include "render_state.h"
+#include "program_binary.h"
+
+unsigned int Shader::skipped_uploads = 0;
 
 Shader& Shader::use() {
-	glUseProgram(this->ID);
+	RenderState::useProgram(this->ID);
 	return *this;
 }
 
-void Shader::compile(const char* vertex_source, const char* fragment_source, const char* geometry_source) {
+bool Shader::compile(const char* vertex_source, const char* fragment_source, const char* geometry_source) {
 	unsigned int s_vertex, s_fragment, g_shader;
+	bool success = true;
 	//vertex Shader
 	s_vertex = glCreateShader(GL_VERTEX_SHADER);
 	glShaderSource(s_vertex, 1, &vertex_source, NULL);
 	glCompileShader(s_vertex);
-	checkCompilationErrors(s_vertex, "VERTEX");
+	success &= checkCompilationErrors(s_vertex, "VERTEX");
 	// fragment Shader
 	s_fragment = glCreateShader(GL_FRAGMENT_SHADER);
 	glShaderSource(s_fragment, 1, &fragment_source, NULL);
 	glCompileShader(s_fragment);
-	checkCompilationErrors(s_fragment, "FRAGMENT");
+	success &= checkCompilationErrors(s_fragment, "FRAGMENT");
 	// if geometry shader source code is given, also compile geometry shader
 	if (geometry_source != nullptr) {
 		g_shader = glCreateShader(GL_GEOMETRY_SHADER);
 		glShaderSource(g_shader, 1, &geometry_source, NULL);
 		glCompileShader(g_shader);
-		checkCompilationErrors(g_shader, "GEOMETRY");
+		success &= checkCompilationErrors(g_shader, "GEOMETRY");
 	}
 	// shader program 
 	this->ID = glCreateProgram();
@@ -31,16 +37,46 @@ void Shader::compile(const char* vertex_source, const char* fragment_source, con
 	glAttachShader(this->ID, s_fragment);
 	if (geometry_source != nullptr)
 		glAttachShader(this->ID, g_shader);
+	// so that ResourceManager can cache the linked program
+	ProgramBinary::setRetrievableHint(this->ID);
 	glLinkProgram(this->ID);
-	checkCompilationErrors(this->ID, "PROGRAM");
+	success &= checkCompilationErrors(this->ID, "PROGRAM");
+	reflectUniforms();
 
 	glDeleteShader(s_vertex);
 	glDeleteShader(s_fragment);
 	if (geometry_source != nullptr)
 		glDeleteShader(g_shader);
+	return success;
 }
 
-void Shader::checkCompilationErrors(unsigned int object, std::string type) {
+bool Shader::reload(const char* vertex_source, const char* fragment_source, const char* geometry_source) {
+	Shader fresh;
+	if (!fresh.compile(vertex_source, fragment_source, geometry_source)) {
+		glDeleteProgram(fresh.ID);
+		return false;
+	}
+	fresh.use();
+	fresh.copyUniformState(*this);
+	glDeleteProgram(this->ID);
+	RenderState::forgetProgram(this->ID);
+	this->ID = fresh.ID;
+	this->uniforms = fresh.uniforms;
+	return true;
+}
+
+bool Shader::loadBinary(GLenum format, const void* binary, int length) {
+	this->ID = glCreateProgram();
+	if (!ProgramBinary::load(this->ID, format, binary, length)) {
+		glDeleteProgram(this->ID);
+		this->ID = 0;
+		return false;
+	}
+	reflectUniforms();
+	return true;
+}
+
+bool Shader::checkCompilationErrors(unsigned int object, std::string type) {
 	int success;
 	char infoLog[1024];
 	if (type != "PROGRAM") {
@@ -61,58 +97,175 @@ void Shader::checkCompilationErrors(unsigned int object, std::string type) {
 				<< std::endl;
 		}
 	}
+	return success != 0;
+}
+void Shader::reflectUniforms() {
+	// a new table, copies of the Shader still using the old program keep theirs
+	uniforms = std::make_shared<UniformTable>();
+	int count = 0;
+	glGetProgramiv(this->ID, GL_ACTIVE_UNIFORMS, &count);
+	char name[256];
+	for (int i = 0; i < count; i++) {
+		int length = 0, size = 0;
+		GLenum type;
+		glGetActiveUniform(this->ID, i, sizeof(name), &length, &size, &type, name);
+		// arrays are reported as "name[0]", make them reachable by their base name too
+		std::string uniform_name(name, length);
+		if (uniform_name.size() > 3 && uniform_name.compare(uniform_name.size() - 3, 3, "[0]") == 0)
+			uniform_name.resize(uniform_name.size() - 3);
+		UniformHandle handle;
+		handle.location = glGetUniformLocation(this->ID, name);
+		if (handle.location < 0) // built-ins and uniform block members have no location
+			continue;
+		handle.slot = static_cast<int>(uniforms->values.size());
+		uniforms->values.emplace_back();
+		uniforms->values.back().type = type;
+		uniforms->handles[uniform_name] = handle;
+	}
+}
+
+UniformHandle Shader::getUniform(const char* name) const {
+	if (!uniforms)
+		return UniformHandle();
+	auto it = uniforms->handles.find(name);
+	return it != uniforms->handles.end() ? it->second : UniformHandle();
+}
+
+void Shader::bindUniformBlock(const char* name, unsigned int binding) {
+	unsigned int index = glGetUniformBlockIndex(this->ID, name);
+	if (index != GL_INVALID_INDEX)
+		glUniformBlockBinding(this->ID, index, binding);
+}
+
+void Shader::copyUniformState(const Shader& from) {
+	if (from.uniforms) {
+		for (const auto& entry : from.uniforms->handles) {
+			const UniformValue& value = from.uniforms->values[entry.second.slot];
+			UniformHandle uniform = getUniform(entry.first.c_str());
+			if (!value.valid || !uniform.isValid() || uniforms->values[uniform.slot].type != value.type)
+				continue;
+			// the cache holds the bytes of the last upload, read them back with their type
+			float floats[16];
+			int integer;
+			std::memcpy(floats, value.data, sizeof(floats));
+			std::memcpy(&integer, value.data, sizeof(integer));
+			switch (value.type) {
+			case GL_FLOAT: setFloat(uniform, floats[0]); break;
+			case GL_FLOAT_VEC2: setVector2f(uniform, glm::vec2(floats[0], floats[1])); break;
+			case GL_FLOAT_VEC3: setVector3f(uniform, glm::vec3(floats[0], floats[1], floats[2])); break;
+			case GL_FLOAT_VEC4: setVector4f(uniform, glm::vec4(floats[0], floats[1], floats[2], floats[3])); break;
+			case GL_FLOAT_MAT4: setMatrix4(uniform, glm::make_mat4(floats)); break;
+			case GL_INT:
+			case GL_BOOL:
+			case GL_SAMPLER_2D: setInteger(uniform, integer); break;
+			}
+		}
+	}
+	GLint block_count = 0;
+	glGetProgramiv(from.ID, GL_ACTIVE_UNIFORM_BLOCKS, &block_count);
+	char name[256];
+	for (int i = 0; i < block_count; i++) {
+		GLint binding = 0;
+		glGetActiveUniformBlockName(from.ID, i, sizeof(name), nullptr, name);
+		glGetActiveUniformBlockiv(from.ID, i, GL_UNIFORM_BLOCK_BINDING, &binding);
+		bindUniformBlock(name, binding);
+	}
+}
+
+bool Shader::updateCachedValue(UniformHandle uniform, const void* data, size_t size) {
+	if (!uniform.isValid())
+		return false;
+	UniformValue& value = uniforms->values[uniform.slot];
+	if (value.valid && std::memcmp(value.data, data, size) == 0) {
+		skipped_uploads++;
+		return false;
+	}
+	std::memcpy(value.data, data, size);
+	value.valid = true;
+	return true;
+}
+
+void Shader::setFloat(UniformHandle uniform, float value)
+{
+	if (updateCachedValue(uniform, &value, sizeof(value)))
+		glUniform1f(uniform.location, value);
+}
+void Shader::setInteger(UniformHandle uniform, int value)
+{
+	if (updateCachedValue(uniform, &value, sizeof(value)))
+		glUniform1i(uniform.location, value);
+}
+void Shader::setVector2f(UniformHandle uniform, const glm::vec2& value)
+{
+	if (updateCachedValue(uniform, &value, sizeof(value)))
+		glUniform2f(uniform.location, value.x, value.y);
+}
+void Shader::setVector3f(UniformHandle uniform, const glm::vec3& value)
+{
+	if (updateCachedValue(uniform, &value, sizeof(value)))
+		glUniform3f(uniform.location, value.x, value.y, value.z);
+}
+void Shader::setVector4f(UniformHandle uniform, const glm::vec4& value)
+{
+	if (updateCachedValue(uniform, &value, sizeof(value)))
+		glUniform4f(uniform.location, value.x, value.y, value.z, value.w);
+}
+void Shader::setMatrix4(UniformHandle uniform, const glm::mat4& matrix)
+{
+	if (updateCachedValue(uniform, &matrix, sizeof(matrix)))
+		glUniformMatrix4fv(uniform.location, 1, false, glm::value_ptr(matrix));
 }
 void Shader::setFloat(const char* name, float value, bool use_shader)
 {
 	if (use_shader)
 		this->use();
-	glUniform1f(glGetUniformLocation(this->ID, name), value);
+	setFloat(getUniform(name), value);
 }
 void Shader::setInteger(const char* name, int value, bool use_shader)
 {
 	if (use_shader)
 		this->use();
-	glUniform1i(glGetUniformLocation(this->ID, name), value);
+	setInteger(getUniform(name), value);
 }
 void Shader::setVector2f(const char* name, float x, float y, bool use_shader)
 {
 	if (use_shader)
 		this->use();
-	glUniform2f(glGetUniformLocation(this->ID, name), x, y);
+	setVector2f(getUniform(name), glm::vec2(x, y));
 }
 void Shader::setVector2f(const char* name, const glm::vec2& value, bool use_shader)
 {
 	if (use_shader)
 		this->use();
-	glUniform2f(glGetUniformLocation(this->ID, name), value.x, value.y);
+	setVector2f(getUniform(name), value);
 }
 void Shader::setVector3f(const char* name, float x, float y, float z, bool use_shader)
 {
 	if (use_shader)
 		this->use();
-	glUniform3f(glGetUniformLocation(this->ID, name), x, y, z);
+	setVector3f(getUniform(name), glm::vec3(x, y, z));
 }
 void Shader::setVector3f(const char* name, const glm::vec3& value, bool use_shader)
 {
 	if (use_shader)
 		this->use();
-	glUniform3f(glGetUniformLocation(this->ID, name), value.x, value.y, value.z);
+	setVector3f(getUniform(name), value);
 }
 void Shader::setVector4f(const char* name, float x, float y, float z, float w, bool use_shader)
 {
 	if (use_shader)
 		this->use();
-	glUniform4f(glGetUniformLocation(this->ID, name), x, y, z, w);
+	setVector4f(getUniform(name), glm::vec4(x, y, z, w));
 }
 void Shader::setVector4f(const char* name, const glm::vec4& value, bool use_shader)
 {
 	if (use_shader)
 		this->use();
-	glUniform4f(glGetUniformLocation(this->ID, name), value.x, value.y, value.z, value.w);
+	setVector4f(getUniform(name), value);
 }
 void Shader::setMatrix4(const char* name, const glm::mat4& matrix, bool use_shader)
 {
 	if (use_shader)
 		this->use();
-	glUniformMatrix4fv(glGetUniformLocation(this->ID, name), 1, false, glm::value_ptr(matrix));
+	setMatrix4(getUniform(name), matrix);
 }
@@ -9,6 +9,16 @@
 #include <iostream>
 #include <sstream>
 #include <fstream>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// pre-resolved uniform of a Shader, obtained once with Shader::getUniform
+struct UniformHandle {
+	int location = -1; // GL uniform location, -1 if the uniform is not active
+	int slot = -1; // index in the value cache of the shader
+	bool isValid() const { return location >= 0; }
+};
 
 class Shader {
 public:
@@ -16,7 +26,21 @@ public:
 	unsigned int ID;
 	Shader() {}
 	Shader& use();
-	void compile(const char* vertex_source, const char* fragment_source, const char* geometry_source);
+	// returns false if a stage failed to compile or the program failed to link, the errors
+	// are printed
+	bool compile(const char* vertex_source, const char* fragment_source, const char* geometry_source);
+	// compiles new sources into a new program that replaces the current one in place, carrying
+	// over the uploaded uniform values and the uniform block bindings. On errors the current
+	// program is kept and false is returned. Only this object sees the new ID, copies of it
+	// keep the deleted program
+	bool reload(const char* vertex_source, const char* fragment_source, const char* geometry_source);
+	// creates the program from a binary returned by ProgramBinary::retrieve. Returns false,
+	// leaving no program, if the driver rejects the binary
+	bool loadBinary(GLenum format, const void* binary, int length);
+	// returns the handle of an active uniform, reflected once after linking
+	UniformHandle getUniform(const char* name) const;
+	// binds the uniform block of the program to a binding point, ignored if the block is not active
+	void bindUniformBlock(const char* name, unsigned int binding);
 	// utility uniform functions
 	void    setFloat(const char* name, float value, bool use_shader = false);
 	void    setInteger(const char* name, int value, bool use_shader = false);
@@ -27,8 +51,41 @@ public:
 	void    setVector4f(const char* name, float x, float y, float z, float w, bool use_shader = false);
 	void    setVector4f(const char* name, const glm::vec4& value, bool use_shader = false);
 	void    setMatrix4(const char* name, const glm::mat4& matrix, bool use_shader = false);
+	// same as above through a pre-resolved handle. Uploads are skipped when the
+	// uniform already holds the value
+	void    setFloat(UniformHandle uniform, float value);
+	void    setInteger(UniformHandle uniform, int value);
+	void    setVector2f(UniformHandle uniform, const glm::vec2& value);
+	void    setVector3f(UniformHandle uniform, const glm::vec3& value);
+	void    setVector4f(UniformHandle uniform, const glm::vec4& value);
+	void    setMatrix4(UniformHandle uniform, const glm::mat4& matrix);
+	// number of uploads skipped by the value cache since the last reset
+	static unsigned int getSkippedUploads() { return skipped_uploads; }
+	static void resetSkippedUploads() { skipped_uploads = 0; }
 private:
-	void checkCompilationErrors(unsigned int object, std::string type);
+	// last value uploaded to a uniform, compared bytewise
+	struct UniformValue {
+		unsigned char data[sizeof(glm::mat4)];
+		GLenum type = 0; // GL type of the uniform, as reflected
+		bool valid = false;
+	};
+	// reflected uniforms and their cached values. The table belongs to the GL program,
+	// so it is shared by all the copies of the Shader object
+	struct UniformTable {
+		std::unordered_map<std::string, UniformHandle> handles;
+		std::vector<UniformValue> values;
+	};
+	std::shared_ptr<UniformTable> uniforms;
+	static unsigned int skipped_uploads;
+
+	// returns true if the object compiled or linked
+	bool checkCompilationErrors(unsigned int object, std::string type);
+	void reflectUniforms();
+	// uploads the cached uniform values of another program to the uniforms of this one with
+	// the same name and type, and copies its uniform block bindings. This program must be in use
+	void copyUniformState(const Shader& from);
+	// returns true if the value has to be uploaded, and records it as the current one
+	bool updateCachedValue(UniformHandle uniform, const void* data, size_t size);
 };
 
 #endif
\ No newline at end of file
@@ -1,10 +1,82 @@
 #include "simulation_manager.h"
-#include "box2DObject.h"
+#include <algorithm>
 #include <random>
 #include <map>
-#include "resource_manager.h"
+#include <cmath>
+#include <future>
+#include <cstdint>
+#include <mutex>
 
+namespace
+{
+    // steps between two regroups of the parallel worlds. The groups are built from the
+    // distance the bodies can travel in that time, so a longer interval means fewer
+    // regroups but larger groups
+    const unsigned int REGROUP_INTERVAL = 8;
+    // extra distance kept between two groups, for the pushes of the collisions
+    const float GROUP_MARGIN = 0.1f;
+    // more worlds than workers, so that uneven groups still balance across the threads
+    const unsigned int WORLDS_PER_WORKER = 2;
+    // items per task of the batched queries
+    const unsigned int RAYS_PER_CHUNK = 64;
+    const unsigned int BOXES_PER_CHUNK = 32;
+    // a world may take this much more than its share of the awake bodies before the
+    // groups spill over to the other worlds
+    const float BALANCE_SLACK = 1.25f;
+
+    void addProfile(b2Profile& sum, const b2Profile& profile)
+    {
+        sum.step += profile.step;
+        sum.collide += profile.collide;
+        sum.solve += profile.solve;
+        sum.solveInit += profile.solveInit;
+        sum.solveVelocity += profile.solveVelocity;
+        sum.solvePosition += profile.solvePosition;
+        sum.broadphase += profile.broadphase;
+        sum.solveTOI += profile.solveTOI;
+    }
+
+    // box around the fixtures of a body, as of its last step
+    b2AABB getBodyBox(const b2Body* body)
+    {
+        b2AABB box;
+        box.lowerBound = box.upperBound = body->GetPosition();
+        for (const b2Fixture* f = body->GetFixtureList(); f != nullptr; f = f->GetNext())
+            for (int32 child = 0; child < f->GetShape()->GetChildCount(); child++)
+                box.Combine(f->GetAABB(child));
+        return box;
+    }
 
+    int findGroup(std::vector<int>& parent, int i)
+    {
+        while (parent[i] != i)
+        {
+            parent[i] = parent[parent[i]];
+            i = parent[i];
+        }
+        return i;
+    }
+
+    // joins the group of the queried body with the groups of the bodies overlapping it.
+    // The lowest store index is kept as the root, so the groups do not depend on the
+    // order of the queries
+    class GroupQueryCallback {
+    public:
+        GroupQueryCallback(const b2DynamicTree& tree, std::vector<int>& parent) : body(0), m_tree(tree), m_parent(parent) {}
+        int body;
+        bool QueryCallback(int32 proxy_id)
+        {
+            int a = findGroup(m_parent, body);
+            int b = findGroup(m_parent, static_cast<int>(reinterpret_cast<intptr_t>(m_tree.GetUserData(proxy_id))));
+            if (a != b)
+                m_parent[std::max(a, b)] = std::min(a, b);
+            return true;
+        }
+    private:
+        const b2DynamicTree& m_tree;
+        std::vector<int>& m_parent;
+    };
+}
 
 SimulationManager::SimulationManager(const float RENDER_SCALE, const unsigned int SCREEN_WIDTH, const unsigned int SCREEN_HEIGHT)
 {
@@ -14,42 +86,950 @@ SimulationManager::SimulationManager(const float RENDER_SCALE, const unsigned in
 
     gravity_on = true;
 	m_gravity = b2Vec2(0.0f, 10.0f);
+    m_gravity_enabled = true;
 	m_world = new b2World(m_gravity);
+    m_restitution = -1.0f;
+
+    m_time_step = 1.0f / 60.0f;
+    m_max_sub_steps = 5;
+    m_max_frame_time = 0.25f;
+    m_accumulator = 0.0f;
+    m_velocity_iterations = 6;
+    m_position_iterations = 2;
+    m_next_handle = 1;
+    m_step_count = 0;
+    m_last_step_time = std::chrono::steady_clock::now();
+    m_profile_sum = b2Profile();
+    m_profiled_steps = 0;
+    m_quit = false;
+    m_state_valid = false;
+    m_cull = false;
+    m_worker_count = 1;
+    m_query_thread_count = 0;
+    m_partitions_dirty = false;
+    m_statics_dirty = false;
+    m_steps_since_regroup = 0;
 
     simulation_state = SimulationState::STOP;
 }
 void SimulationManager::setGravity(const b2Vec2 gravity) 
 {
-    m_gravity = gravity;
-    m_world->SetGravity(m_gravity);
+    execute([this, gravity] {
+        m_gravity = gravity;
+        for (unsigned int i = 0; i < getWorldCount(); i++)
+            getWorld(i)->SetGravity(m_gravity);
+        m_partitions_dirty = true;
+    });
 }
 void SimulationManager::enableGravity()
 {
-    if (gravity_on)
-        m_world->SetGravity(m_gravity);
-    else
-        m_world->SetGravity(b2Vec2_zero);
+    const bool on = gravity_on;
+    execute([this, on] {
+        m_gravity_enabled = on;
+        for (unsigned int i = 0; i < getWorldCount(); i++)
+            getWorld(i)->SetGravity(on ? m_gravity : b2Vec2_zero);
+        m_partitions_dirty = true;
+    });
+}
+
+void SimulationManager::setRestitution(const float restitution)
+{
+    execute([this, restitution] {
+        m_restitution = restitution;
+        if (restitution < 0.0f)
+            return;
+        for (unsigned int i = 0; i < getWorldCount(); i++)
+        {
+            b2World* world = getWorld(i);
+            for (b2Body* b = world->GetBodyList(); b != nullptr; b = b->GetNext())
+                for (b2Fixture* f = b->GetFixtureList(); f != nullptr; f = f->GetNext())
+                    f->SetRestitution(restitution);
+            // contacts mix the restitution of their fixtures when they are created
+            for (b2Contact* c = world->GetContactList(); c != nullptr; c = c->GetNext())
+                c->ResetRestitution();
+        }
+    });
 }
 
 SimulationManager::~SimulationManager() 
 {
+    stopThread();
+    for (b2World* world : m_partitions)
+        delete world;
     delete m_world;
 }
 
 void SimulationManager::clearObjects()
 {
-    m_objects.clear();
-    for (b2Body* b = m_world->GetBodyList(); b != nullptr;)
+    m_state_valid = false;
+    execute([this] {
+        m_bodies.clear();
+        destroyAllBodies();
+    });
+}
+
+void SimulationManager::destroyAllBodies()
+{
+    for (unsigned int i = 0; i < getWorldCount(); i++)
+    {
+        b2World* world = getWorld(i);
+        for (b2Body* b = world->GetBodyList(); b != nullptr;)
+        {
+            b2Body* next = b->GetNext();
+            world->DestroyBody(b);
+            b = next;
+        }
+    }
+    m_static_replicas.clear();
+    m_partitions_dirty = true;
+    m_statics_dirty = true;
+}
+
+void SimulationManager::reserveBodies(const unsigned int count)
+{
+    execute([this, count] { m_bodies.reserve(m_bodies.size() + count); });
+}
+
+BodyHandle SimulationManager::createBox(const glm::vec2& position, const glm::vec2& dimensions, const float rotation, const glm::vec3& color)
+{
+    const BodyHandle handle = m_next_handle++;
+    m_state_valid = false;
+    execute([this, handle, position, dimensions, rotation, color] {
+        BodyState state;
+        state.handle = handle;
+        state.kind = BodyKind::BOX;
+        state.type = b2_dynamicBody;
+        state.position.Set(position.x, position.y);
+        state.angle = rotation;
+        state.dimensions = dimensions;
+        state.color = color;
+        state.density = 1.0f;
+        state.friction = 0.3f;
+        state.restitution = getRestitution(0.0f);
+        createBody(state);
+    });
+    return handle;
+}
+
+BodyHandle SimulationManager::createWall(const glm::vec2& position, const glm::vec2& dimensions, const float rotation, const glm::vec3& color)
+{
+    const BodyHandle handle = m_next_handle++;
+    m_state_valid = false;
+    execute([this, handle, position, dimensions, rotation, color] {
+        BodyState state;
+        state.handle = handle;
+        state.kind = BodyKind::WALL;
+        state.type = b2_staticBody;
+        state.position.Set(position.x, position.y);
+        state.angle = rotation;
+        state.dimensions = dimensions;
+        state.color = color;
+        state.restitution = getRestitution(0.0f);
+        createBody(state);
+    });
+    return handle;
+}
+
+BodyHandle SimulationManager::createCircle(const glm::vec2& position, const float radius, const b2BodyType type, const glm::vec3& color)
+{
+    const BodyHandle handle = m_next_handle++;
+    m_state_valid = false;
+    execute([this, handle, position, radius, type, color] {
+        BodyState state;
+        state.handle = handle;
+        state.kind = BodyKind::BALL;
+        state.type = type;
+        state.position.Set(position.x, position.y);
+        state.dimensions = glm::vec2(2 * radius, 2 * radius);
+        state.color = color;
+        state.density = 1.0f;
+        state.friction = 0.3f;
+        state.restitution = getRestitution(0.5f);
+        createBody(state);
+    });
+    return handle;
+}
+
+void SimulationManager::createBody(const BodyState& state)
+{
+    addBody(state.handle, buildBody(state, m_world), state.kind, state.dimensions, state.color);
+}
+
+b2Body* SimulationManager::buildBody(const BodyState& state, b2World* world)
+{
+    b2BodyDef bodyDef;
+    bodyDef.type = state.type;
+    bodyDef.position = state.position;
+    bodyDef.angle = state.angle;
+    bodyDef.linearVelocity = state.linear_velocity;
+    bodyDef.angularVelocity = state.angular_velocity;
+    bodyDef.linearDamping = state.linear_damping;
+    bodyDef.angularDamping = state.angular_damping;
+    bodyDef.allowSleep = state.sleeping_allowed;
+    bodyDef.awake = state.awake;
+    bodyDef.fixedRotation = state.fixed_rotation;
+    bodyDef.bullet = state.bullet;
+    bodyDef.enabled = state.enabled;
+    bodyDef.gravityScale = state.gravity_scale;
+    b2Body* body = world->CreateBody(&bodyDef);
+    body->GetUserData().pointer = state.handle;
+
+    b2PolygonShape box;
+    b2CircleShape circle;
+    b2FixtureDef fixtureDef;
+    if (state.kind == BodyKind::BALL)
+    {
+        circle.m_p.Set(0.0f, 0.0f);
+        circle.m_radius = state.dimensions.x / 2;
+        fixtureDef.shape = &circle;
+    }
+    else
+    {
+        box.SetAsBox(state.dimensions.x / 2, state.dimensions.y / 2);
+        fixtureDef.shape = &box;
+    }
+    fixtureDef.density = state.density;
+    fixtureDef.friction = state.friction;
+    fixtureDef.restitution = state.restitution;
+    fixtureDef.restitutionThreshold = state.restitution_threshold;
+    body->CreateFixture(&fixtureDef);
+    return body;
+}
+
+void SimulationManager::addBody(BodyHandle handle, b2Body* body, BodyKind kind, const glm::vec2& dimensions, const glm::vec3& color)
+{
+    m_bodies.add(handle, body, kind, dimensions, color);
+    m_partitions_dirty = true;
+    if (body->GetType() == b2_staticBody)
+        m_statics_dirty = true;
+}
+
+void SimulationManager::destroyObject(BodyHandle handle)
+{
+    m_state_valid = false;
+    execute([this, handle] {
+        int index = m_bodies.indexOf(handle);
+        if (index < 0)
+            return;
+        b2Body* body = m_bodies.bodies[index];
+        if (body->GetType() == b2_staticBody)
+            m_statics_dirty = true;
+        body->GetWorld()->DestroyBody(body);
+        m_bodies.remove(handle);
+        m_partitions_dirty = true;
+    });
+}
+
+void SimulationManager::setPosition(BodyHandle handle, const b2Vec2& position)
+{
+    m_state_valid = false;
+    execute([this, handle, position] {
+        int index = m_bodies.indexOf(handle);
+        if (index < 0)
+            return;
+        b2Body* body = m_bodies.bodies[index];
+        body->SetTransform(position, body->GetAngle());
+        m_bodies.storePreviousTransform(index);
+        m_partitions_dirty = true;
+        if (body->GetType() == b2_staticBody)
+            m_statics_dirty = true;
+    });
+}
+
+void SimulationManager::setRotation(BodyHandle handle, const float angle)
+{
+    m_state_valid = false;
+    execute([this, handle, angle] {
+        int index = m_bodies.indexOf(handle);
+        if (index < 0)
+            return;
+        b2Body* body = m_bodies.bodies[index];
+        body->SetTransform(body->GetPosition(), angle);
+        m_bodies.storePreviousTransform(index);
+        m_partitions_dirty = true;
+        if (body->GetType() == b2_staticBody)
+            m_statics_dirty = true;
+    });
+}
+
+void SimulationManager::setTimeStep(const float time_step)
+{
+    execute([this, time_step] {
+        m_time_step = time_step;
+        m_accumulator = 0.0f;
+    });
+}
+
+void SimulationManager::setMaxSubSteps(const int max_sub_steps)
+{
+    execute([this, max_sub_steps] { m_max_sub_steps = max_sub_steps > 0 ? max_sub_steps : 1; });
+}
+
+int SimulationManager::update(float frame_time)
+{
+    if (frame_time > m_max_frame_time)
+        frame_time = m_max_frame_time;
+    m_accumulator += frame_time;
+
+    int steps = 0;
+    while (m_accumulator >= m_time_step && steps < m_max_sub_steps)
+    {
+        step();
+        m_accumulator -= m_time_step;
+        steps++;
+    }
+    // spiral of death: if the steps can't keep up, drop the backlog instead of
+    // trying to catch up on the next frame
+    if (m_accumulator >= m_time_step)
+        m_accumulator = fmodf(m_accumulator, m_time_step);
+    return steps;
+}
+
+void SimulationManager::step()
+{
+    m_bodies.storePreviousTransforms();
+    b2Profile profile = b2Profile();
+    if (m_partitions.empty())
+    {
+        m_world->Step(m_time_step, m_velocity_iterations, m_position_iterations);
+        profile = m_world->GetProfile();
+    }
+    else
+    {
+        if (m_partitions_dirty || m_steps_since_regroup >= REGROUP_INTERVAL)
+            partitionBodies();
+        b2Timer timer;
+        m_pool->parallelFor(static_cast<int>(getWorldCount()), [this](int i) {
+            getWorld(i)->Step(m_time_step, m_velocity_iterations, m_position_iterations);
+        });
+        m_steps_since_regroup++;
+        if (hasBodyLeftGroup())
+            m_partitions_dirty = true;
+        // the phases add up the time of every world, the step is the wall time
+        for (unsigned int i = 0; i < getWorldCount(); i++)
+            addProfile(profile, getWorld(i)->GetProfile());
+        profile.step = timer.GetMilliseconds();
+    }
+    m_step_count++;
+    m_last_step_time = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lock(m_profile_mutex);
+    addProfile(m_profile_sum, profile);
+    m_profiled_steps++;
+}
+
+void SimulationManager::setWorkerCount(unsigned int worker_count)
+{
+    if (worker_count == 0)
+        worker_count = std::max(1u, std::thread::hardware_concurrency());
+    m_worker_count = worker_count;
+    execute([this, worker_count] {
+        if (m_pool ? m_pool->getThreadCount() == worker_count : worker_count <= 1)
+            return;
+        // gather everything back into m_world, then split it again over the new worlds
+        for (unsigned int i = 0; i < m_bodies.size(); i++)
+            if (m_bodies.bodies[i]->GetWorld() != m_world)
+                moveBody(i, m_world);
+        for (b2Body* replica : m_static_replicas)
+            replica->GetWorld()->DestroyBody(replica);
+        m_static_replicas.clear();
+        for (b2World* world : m_partitions)
+            delete world;
+        m_partitions.clear();
+        m_group_boxes.clear();
+        m_pool.reset();
+        if (worker_count <= 1)
+            return;
+        initializeContactRegisters();
+        m_pool = std::make_unique<ThreadPool>(worker_count);
+        for (unsigned int i = 1; i < worker_count * WORLDS_PER_WORKER; i++)
+            m_partitions.push_back(new b2World(m_world->GetGravity()));
+        m_partitions_dirty = true;
+        m_statics_dirty = true;
+    });
+}
+
+void SimulationManager::initializeContactRegisters()
+{
+    // one contact created in a scratch world fills the table
+    static std::once_flag once;
+    std::call_once(once, [] {
+        b2World world(b2Vec2_zero);
+        b2BodyDef body_def;
+        body_def.type = b2_dynamicBody;
+        b2CircleShape circle;
+        circle.m_radius = 1.0f;
+        world.CreateBody(&body_def)->CreateFixture(&circle, 1.0f);
+        world.CreateBody(&body_def)->CreateFixture(&circle, 1.0f);
+        world.Step(1.0f / 60.0f, 1, 1);
+    });
+}
+
+void SimulationManager::moveBody(unsigned int index, b2World* world)
+{
+    b2Body* body = m_bodies.bodies[index];
+    const BodyState state = WorldState::captureBody(m_bodies.handles[index], m_bodies.kinds[index], m_bodies.dimensions[index], m_bodies.colors[index], body);
+    body->GetWorld()->DestroyBody(body);
+    m_bodies.bodies[index] = buildBody(state, world);
+}
+
+void SimulationManager::rebuildStaticReplicas()
+{
+    for (b2Body* replica : m_static_replicas)
+        replica->GetWorld()->DestroyBody(replica);
+    m_static_replicas.clear();
+    for (unsigned int i = 0; i < m_bodies.size(); i++)
+    {
+        if (m_bodies.bodies[i]->GetType() != b2_staticBody)
+            continue;
+        const BodyState state = WorldState::captureBody(m_bodies.handles[i], m_bodies.kinds[i], m_bodies.dimensions[i], m_bodies.colors[i], m_bodies.bodies[i]);
+        for (b2World* world : m_partitions)
+            m_static_replicas.push_back(buildBody(state, world));
+    }
+}
+
+// Box2D solves each island of touching bodies on its own, but the islands are built
+// inside b2World::Step. Instead, the bodies are grouped here by what they may touch
+// before the next regroup, and each group is stepped in one of the worlds. Static
+// bodies don't move, so they are copied into every world instead of joining groups.
+//
+// Bodies in different worlds never collide, so this is an approximation of stepping a
+// single world, not the same simulation:
+// - the groups are built from boxes predicted from the current velocities. After each
+//   step, a body whose box may leave its group's before the next step forces a
+//   regroup (hasBodyLeftGroup), but a body knocked within a step farther than its
+//   velocity predicted can overlap a body of another group for that step, and is
+//   pushed out of it after the regroup
+// - a body changing world is recreated there, which drops its contacts: the first step
+//   after a move starts without warm starting
+// - the solver order differs, so the results differ from a single world even when
+//   no collision is missed
+// For a given worker count, the assignment only depends on the bodies and on the worlds
+// they were in.
+void SimulationManager::partitionBodies()
+{
+    const unsigned int count = m_bodies.size();
+    const unsigned int world_count = getWorldCount();
+    if (m_statics_dirty)
+    {
+        rebuildStaticReplicas();
+        m_statics_dirty = false;
+    }
+
+    // the boxes of the moving bodies, grown by the distance they can travel until the
+    // next regroup. Bodies whose boxes overlap end up in the same group
+    const float horizon = m_time_step * REGROUP_INTERVAL;
+    const float fall = 0.5f * m_world->GetGravity().Length() * horizon * horizon;
+    b2DynamicTree tree;
+    std::vector<b2AABB>& boxes = m_group_boxes;
+    boxes.resize(count);
+    std::vector<int> parent(count);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        parent[i] = static_cast<int>(i);
+        const b2Body* body = m_bodies.bodies[i];
+        if (body->GetType() == b2_staticBody)
+            continue;
+        b2AABB box = getBodyBox(body);
+        const float radius = 0.5f * (box.upperBound - box.lowerBound).Length();
+        float margin = (body->GetLinearVelocity().Length() + b2Abs(body->GetAngularVelocity()) * radius) * horizon + GROUP_MARGIN;
+        if (body->GetType() == b2_dynamicBody)
+            margin += fall * b2Abs(body->GetGravityScale());
+        box.lowerBound -= b2Vec2(margin, margin);
+        box.upperBound += b2Vec2(margin, margin);
+        boxes[i] = box;
+        tree.CreateProxy(box, reinterpret_cast<void*>(static_cast<intptr_t>(i)));
+    }
+    GroupQueryCallback callback(tree, parent);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (m_bodies.bodies[i]->GetType() == b2_staticBody)
+            continue;
+        callback.body = static_cast<int>(i);
+        tree.Query(&callback, boxes[i]);
+    }
+
+    // the load of a group is its number of awake bodies, sleeping bodies cost next to
+    // nothing to step. world_bodies counts the bodies of each group in each world
+    struct Group
+    {
+        unsigned int first;
+        unsigned int load;
+    };
+    std::vector<Group> groups;
+    std::vector<int> group_index(count, -1);
+    std::vector<unsigned int> world_bodies;
+    unsigned int total_load = 0;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        const b2Body* body = m_bodies.bodies[i];
+        if (body->GetType() == b2_staticBody)
+            continue;
+        const int root = findGroup(parent, static_cast<int>(i));
+        if (group_index[root] < 0)
+        {
+            group_index[root] = static_cast<int>(groups.size());
+            groups.push_back({ i, 0 });
+            world_bodies.resize(world_bodies.size() + world_count, 0);
+        }
+        const unsigned int group = static_cast<unsigned int>(group_index[root]);
+        if (body->IsAwake())
+        {
+            groups[group].load++;
+            total_load++;
+        }
+        unsigned int world = 0;
+        while (getWorld(world) != body->GetWorld())
+            world++;
+        world_bodies[group * world_count + world]++;
+    }
+
+    // heaviest groups first. A group stays in the world holding most of its bodies
+    // while that world has room, otherwise it goes to the least loaded world
+    std::vector<unsigned int> order(groups.size());
+    for (unsigned int g = 0; g < order.size(); g++)
+        order[g] = g;
+    std::sort(order.begin(), order.end(), [&groups](unsigned int a, unsigned int b) {
+        if (groups[a].load != groups[b].load)
+            return groups[a].load > groups[b].load;
+        return groups[a].first < groups[b].first;
+    });
+    const float capacity = BALANCE_SLACK * total_load / world_count;
+    std::vector<unsigned int> world_loads(world_count, 0);
+    std::vector<unsigned int> targets(groups.size());
+    for (unsigned int g : order)
+    {
+        const unsigned int* bodies = &world_bodies[g * world_count];
+        unsigned int target = 0;
+        for (unsigned int w = 1; w < world_count; w++)
+            if (bodies[w] > bodies[target])
+                target = w;
+        if (world_loads[target] + groups[g].load > capacity)
+            for (unsigned int w = 0; w < world_count; w++)
+                if (world_loads[w] < world_loads[target])
+                    target = w;
+        world_loads[target] += groups[g].load;
+        targets[g] = target;
+    }
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (m_bodies.bodies[i]->GetType() == b2_staticBody)
+            continue;
+        b2World* world = getWorld(targets[group_index[findGroup(parent, static_cast<int>(i))]]);
+        if (m_bodies.bodies[i]->GetWorld() != world)
+            moveBody(i, world);
+    }
+    m_partitions_dirty = false;
+    m_steps_since_regroup = 0;
+}
+
+bool SimulationManager::hasBodyLeftGroup() const
+{
+    // the fixture boxes, which include the polygon skin, grown by how far the body can
+    // move in the next step, must stay in the boxes of the last regroup
+    const float fall = 0.5f * m_world->GetGravity().Length() * m_time_step * m_time_step;
+    for (unsigned int i = 0; i < m_bodies.size(); i++)
+    {
+        const b2Body* body = m_bodies.bodies[i];
+        if (body->GetType() == b2_staticBody)
+            continue;
+        b2AABB box = getBodyBox(body);
+        const float radius = 0.5f * (box.upperBound - box.lowerBound).Length();
+        float margin = (body->GetLinearVelocity().Length() + b2Abs(body->GetAngularVelocity()) * radius) * m_time_step;
+        if (body->GetType() == b2_dynamicBody)
+            margin += fall * b2Abs(body->GetGravityScale());
+        box.lowerBound -= b2Vec2(margin, margin);
+        box.upperBound += b2Vec2(margin, margin);
+        if (!m_group_boxes[i].Contains(box))
+            return true;
+    }
+    return false;
+}
+
+void SimulationManager::collectProfile(Profiler& profiler)
+{
+    std::lock_guard<std::mutex> lock(m_profile_mutex);
+    if (m_profiled_steps > 0)
+        profiler.addStep(m_profile_sum, m_profiled_steps);
+    m_profile_sum = b2Profile();
+    m_profiled_steps = 0;
+}
+
+// collects the store indices of the bodies with a fixture in the query box
+class VisibleBodiesCallback : public b2QueryCallback {
+public:
+    VisibleBodiesCallback(const BodyStore& bodies, std::vector<unsigned int>& visible) : m_bodies(bodies), m_visible(visible) {}
+    bool ReportFixture(b2Fixture* fixture) override
+    {
+        int index = m_bodies.indexOf(static_cast<BodyHandle>(fixture->GetBody()->GetUserData().pointer));
+        if (index >= 0)
+            m_visible.push_back(static_cast<unsigned int>(index));
+        return true;
+    }
+private:
+    const BodyStore& m_bodies;
+    std::vector<unsigned int>& m_visible;
+};
+
+void SimulationManager::setViewBounds(const b2AABB& bounds)
+{
+    execute([this, bounds] {
+        m_view_bounds = bounds;
+        m_cull = true;
+    });
+}
+
+void SimulationManager::clearViewBounds()
+{
+    execute([this] { m_cull = false; });
+}
+
+void SimulationManager::publishSnapshot()
+{
+    BodySnapshot& snapshot = m_snapshots.getWriteBuffer();
+    if (m_cull)
+    {
+        m_visible.clear();
+        VisibleBodiesCallback callback(m_bodies, m_visible);
+        for (unsigned int i = 0; i < getWorldCount(); i++)
+            getWorld(i)->QueryAABB(&callback, m_view_bounds);
+        // bodies with several fixtures are reported once per fixture, static bodies
+        // once per world, and the store
+        // order is kept so that the drawing order does not flicker
+        std::sort(m_visible.begin(), m_visible.end());
+        m_visible.erase(std::unique(m_visible.begin(), m_visible.end()), m_visible.end());
+        snapshot.capture(m_bodies, m_visible);
+    }
+    else
+        snapshot.capture(m_bodies);
+    snapshot.total_bodies = m_bodies.size();
+    snapshot.step_time = m_last_step_time;
+    snapshot.time_step = m_time_step;
+    snapshot.step_count = m_step_count;
+    m_snapshots.publish();
+}
+
+void SimulationManager::setQueryThreadCount(unsigned int thread_count)
+{
+    execute([this, thread_count] {
+        m_query_thread_count = thread_count;
+        // the next batch creates the pool again with the new count
+        m_query_pool.reset();
+    });
+}
+
+void SimulationManager::castRays(RayCastBatch& batch)
+{
+    executeAndWait([this, &batch] {
+        batch.resetResults();
+        forEachChunk(batch.size(), RAYS_PER_CHUNK, [this, &batch](unsigned int begin, unsigned int end) {
+            for (unsigned int w = 0; w < getWorldCount(); w++)
+                ::castRays(*getWorld(w), batch, begin, end);
+        });
+    });
+}
+
+void SimulationManager::queryBoxes(BoxQueryBatch& batch)
+{
+    executeAndWait([this, &batch] {
+        batch.resetResults((batch.size() + BOXES_PER_CHUNK - 1) / BOXES_PER_CHUNK);
+        forEachChunk(batch.size(), BOXES_PER_CHUNK, [this, &batch](unsigned int begin, unsigned int end) {
+            std::vector<BodyHandle>& hits = batch.chunk_hits[begin / BOXES_PER_CHUNK];
+            for (unsigned int i = begin; i < end; i++)
+            {
+                const size_t first = hits.size();
+                for (unsigned int w = 0; w < getWorldCount(); w++)
+                    queryBox(*getWorld(w), batch.boxes[i], hits);
+                // bodies with several fixtures, and static bodies copied in every world
+                std::sort(hits.begin() + first, hits.end());
+                hits.erase(std::unique(hits.begin() + first, hits.end()), hits.end());
+                batch.counts[i] = static_cast<unsigned int>(hits.size() - first);
+            }
+        });
+        batch.mergeChunks();
+    });
+}
+
+void SimulationManager::getStaticBodies(std::vector<BodyState>& bodies)
+{
+    bodies.clear();
+    executeAndWait([this, &bodies] {
+        for (unsigned int i = 0; i < m_bodies.size(); i++)
+            if (m_bodies.bodies[i]->GetType() == b2_staticBody)
+                bodies.push_back(WorldState::captureBody(m_bodies.handles[i], m_bodies.kinds[i], m_bodies.dimensions[i], m_bodies.colors[i], m_bodies.bodies[i]));
+    });
+}
+
+void SimulationManager::forEachChunk(unsigned int count, unsigned int chunk_size, const std::function<void(unsigned int, unsigned int)>& body)
+{
+    const unsigned int chunks = (count + chunk_size - 1) / chunk_size;
+    auto chunk = [count, chunk_size, &body](int c) {
+        const unsigned int begin = c * chunk_size;
+        body(begin, std::min(begin + chunk_size, count));
+    };
+    if (chunks <= 1)
+    {
+        if (chunks == 1)
+            chunk(0);
+        return;
+    }
+    // the worlds are not stepped while a batch runs, so the chunks only read them
+    if (!m_query_pool)
+        m_query_pool = std::make_unique<ThreadPool>(m_query_thread_count);
+    m_query_pool->parallelFor(static_cast<int>(chunks), chunk);
+}
+
+const BodySnapshot& SimulationManager::acquireSnapshot()
+{
+    m_snapshots.update();
+    return m_snapshots.getReadBuffer();
+}
+
+void SimulationManager::captureState()
+{
+    m_state_valid = true;
+    execute([this] {
+        std::lock_guard<std::mutex> lock(m_state_mutex);
+        m_state.gravity = m_gravity;
+        m_state.time_step = m_time_step;
+        m_state.bodies.clear();
+        m_state.bodies.reserve(m_bodies.size());
+        for (unsigned int i = 0; i < m_bodies.size(); i++)
+            m_state.bodies.push_back(WorldState::captureBody(m_bodies.handles[i], m_bodies.kinds[i], m_bodies.dimensions[i], m_bodies.colors[i], m_bodies.bodies[i]));
+    });
+}
+
+bool SimulationManager::restoreState()
+{
+    if (!m_state_valid)
+        return false;
+    execute([this] {
+        std::lock_guard<std::mutex> lock(m_state_mutex);
+        applyState(m_state);
+    });
+    return true;
+}
+
+bool SimulationManager::saveState(const std::string& filePath)
+{
+    if (!m_state_valid)
+        return false;
+    // the capture may still be queued, wait for it
+    WorldState state;
+    executeAndWait([this, &state] {
+        std::lock_guard<std::mutex> lock(m_state_mutex);
+        state = m_state;
+    });
+    return saveWorldState(filePath, state);
+}
+
+bool SimulationManager::loadState(const std::string& filePath)
+{
+    WorldState state;
+    if (!loadWorldState(filePath, &state))
+        return false;
+    // the file's handles must not be handed out again
+    for (const BodyState& body : state.bodies)
     {
-        b2Body* next = b->GetNext();
-        m_world->DestroyBody(b);
-        b = next;
+        BodyHandle next = m_next_handle;
+        while (body.handle >= next && !m_next_handle.compare_exchange_weak(next, body.handle + 1))
+            ;
     }
+    m_state_valid = true;
+    execute([this, state] {
+        std::lock_guard<std::mutex> lock(m_state_mutex);
+        m_state = state;
+        rebuildFromState(m_state);
+    });
+    return true;
 }
 
-void SimulationManager::clearLastObject()
+void SimulationManager::applyState(const WorldState& state)
 {
-    if(m_world->GetBodyCount())
-        m_world->DestroyBody(m_world->GetBodyList());
+    bool in_place = state.bodies.size() == m_bodies.size();
+    for (unsigned int i = 0; in_place && i < state.bodies.size(); i++)
+    {
+        int index = m_bodies.indexOf(state.bodies[i].handle);
+        in_place = index >= 0 && m_bodies.kinds[index] == state.bodies[i].kind && m_bodies.dimensions[index] == state.bodies[i].dimensions;
+    }
+    if (!in_place)
+    {
+        rebuildFromState(state);
+        return;
+    }
+
+    m_gravity = state.gravity;
+    m_time_step = state.time_step;
+    for (unsigned int i = 0; i < getWorldCount(); i++)
+        getWorld(i)->SetGravity(m_gravity_enabled ? m_gravity : b2Vec2_zero);
+    for (const BodyState& body_state : state.bodies)
+    {
+        b2Body* body = m_bodies.bodies[m_bodies.indexOf(body_state.handle)];
+        if (body->GetType() == b2_staticBody || body_state.type == b2_staticBody)
+        {
+            // the replicas only need rebuilding if a static body actually changes
+            if (body->GetType() != body_state.type || !(body->GetPosition() == body_state.position) || body->GetAngle() != body_state.angle)
+                m_statics_dirty = true;
+        }
+        if (body->GetType() != body_state.type)
+            body->SetType(body_state.type);
+        body->SetEnabled(body_state.enabled);
+        // SetFixedRotation clears the angular velocity, so it goes before the velocities
+        body->SetFixedRotation(body_state.fixed_rotation);
+        body->SetBullet(body_state.bullet);
+        body->SetSleepingAllowed(body_state.sleeping_allowed);
+        body->SetLinearDamping(body_state.linear_damping);
+        body->SetAngularDamping(body_state.angular_damping);
+        body->SetGravityScale(body_state.gravity_scale);
+
+        b2Fixture* fixture = body->GetFixtureList();
+        if (fixture->GetDensity() != body_state.density)
+        {
+            fixture->SetDensity(body_state.density);
+            body->ResetMassData();
+        }
+        fixture->SetFriction(body_state.friction);
+        fixture->SetRestitution(body_state.restitution);
+        fixture->SetRestitutionThreshold(body_state.restitution_threshold);
+
+        body->SetTransform(body_state.position, body_state.angle);
+        body->SetLinearVelocity(body_state.linear_velocity);
+        body->SetAngularVelocity(body_state.angular_velocity);
+        // also resets the sleep timer (and the velocities of sleeping bodies)
+        body->SetAwake(body_state.awake);
+    }
+    // the surviving contacts would warm start the solver with the impulses of the end
+    // of the run; a new world starts cold, so drop them
+    for (unsigned int w = 0; w < getWorldCount(); w++)
+        for (b2Contact* c = getWorld(w)->GetContactList(); c != nullptr; c = c->GetNext())
+        {
+            b2Manifold* manifold = c->GetManifold();
+            for (int i = 0; i < manifold->pointCount; i++)
+            {
+                manifold->points[i].normalImpulse = 0.0f;
+                manifold->points[i].tangentImpulse = 0.0f;
+            }
+            c->ResetFriction();
+            c->ResetRestitution();
+            c->ResetRestitutionThreshold();
+        }
+    m_partitions_dirty = true;
+    m_bodies.storePreviousTransforms();
+    m_accumulator = 0.0f;
 }
 
+void SimulationManager::rebuildFromState(const WorldState& state)
+{
+    m_gravity = state.gravity;
+    m_time_step = state.time_step;
+    const b2Vec2 gravity = m_gravity_enabled ? m_gravity : b2Vec2_zero;
+    m_bodies.clear();
+    m_static_replicas.clear();
+    delete m_world;
+    m_world = new b2World(gravity);
+    for (b2World*& world : m_partitions)
+    {
+        delete world;
+        world = new b2World(gravity);
+    }
+    m_bodies.reserve(static_cast<unsigned int>(state.bodies.size()));
+    for (const BodyState& body_state : state.bodies)
+        createBody(body_state);
+    m_partitions_dirty = true;
+    m_statics_dirty = true;
+    m_bodies.storePreviousTransforms();
+    m_accumulator = 0.0f;
+}
+
+void SimulationManager::execute(std::function<void()> command)
+{
+    if (!m_thread.joinable())
+    {
+        command();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_command_mutex);
+        m_commands.push_back(std::move(command));
+    }
+    m_wake.notify_one();
+}
+
+void SimulationManager::executeAndWait(std::function<void()> command)
+{
+    if (!m_thread.joinable())
+    {
+        command();
+        return;
+    }
+    std::promise<void> done;
+    std::future<void> finished = done.get_future();
+    execute([&command, &done] {
+        command();
+        done.set_value();
+    });
+    finished.wait();
+}
+
+bool SimulationManager::runCommands()
+{
+    // take the whole queue at once, the lock is not held while the commands run
+    std::vector<std::function<void()>> commands;
+    {
+        std::lock_guard<std::mutex> lock(m_command_mutex);
+        commands.swap(m_commands);
+    }
+    for (auto& command : commands)
+        command();
+    return !commands.empty();
+}
+
+void SimulationManager::startThread()
+{
+    if (m_thread.joinable())
+        return;
+    m_quit = false;
+    publishSnapshot();
+    m_thread = std::thread(&SimulationManager::threadLoop, this);
+}
+
+void SimulationManager::stopThread()
+{
+    if (!m_thread.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(m_command_mutex);
+        m_quit = true;
+    }
+    m_wake.notify_one();
+    m_thread.join();
+    // commands queued after the thread's last iteration
+    runCommands();
+}
+
+void SimulationManager::threadLoop()
+{
+    typedef std::chrono::steady_clock clock;
+    clock::time_point last_time = clock::now();
+    for (;;)
+    {
+        {
+            // sleep until the next step is due, or a command or a stop request comes in
+            std::unique_lock<std::mutex> lock(m_command_mutex);
+            float wait = simulate ? m_time_step - m_accumulator : m_time_step;
+            m_wake.wait_for(lock, std::chrono::duration<float>(wait), [this] { return m_quit || !m_commands.empty(); });
+            if (m_quit)
+                return;
+        }
+        const bool edited = runCommands();
+
+        clock::time_point now = clock::now();
+        const float elapsed = std::chrono::duration<float>(now - last_time).count();
+        last_time = now;
+        // the time spent paused is not accumulated
+        const int steps = simulate ? update(elapsed) : 0;
+        if (steps > 0 || edited)
+            publishSnapshot();
+    }
+}
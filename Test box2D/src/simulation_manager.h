@@ -1,11 +1,21 @@
 #pragma once
 #include <box2d/box2d.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <string>
 #include <map>
-#include "sprite_renderer.h"
-#include "texture.h"
-#include "box2DObject.h"
+#include <memory>
+#include <glm/glm.hpp>
+#include "batch_query.h"
+#include "body_store.h"
+#include "profiler.h"
+#include "thread_pool.h"
+#include "triple_buffer.h"
+#include "world_state.h"
 #include <random>
 
 enum class SimulationState
@@ -15,33 +25,213 @@ enum class SimulationState
 	STOP
 };
 
+// Owns the b2World and its bodies. The world can be driven directly (step/update,
+// used by the headless tools) or by a simulation thread started with startThread().
+// While the thread runs, it is the only one touching the world: every edit below is
+// queued as a command and applied by the thread before its next step, and the
+// renderer reads the bodies through the snapshots published after each step.
+//
+// With more than one worker (setWorkerCount), the bodies are spread over several
+// b2Worlds that are stepped in parallel, see partitionBodies.
 class SimulationManager
 {
 public:
 
 	bool play = false;
 	bool stop = false;
-	bool simulate = true;
+	std::atomic<bool> simulate{ false }; // set by Play, read by the simulation thread
 
 	SimulationState simulation_state;
 
+	// the world holding the static bodies, and every body when stepping on one worker
 	b2World* m_world;
 	bool gravity_on;
 
-	std::map<int, std::vector<Box2DObject>> m_objects;
+	// every body of the simulation, see BodyStore. Owned by the simulation thread while it runs
+	BodyStore m_bodies;
 
 	SimulationManager(const float RENDER_SCALE, const unsigned int SCREEN_WIDTH, const unsigned int SCREEN_HEIGHT);
 	~SimulationManager();
 	void setGravity(const b2Vec2 gravity);
 	void enableGravity();
-	void clearLastObject();
+	b2Vec2 getGravity() const { return m_gravity; }
+	// overrides the restitution of every fixture, including the ones created later.
+	// A negative value restores the per-kind defaults for bodies created afterwards
+	void setRestitution(const float restitution);
 	void clearObjects();
+	// makes room for count more bodies
+	void reserveBodies(const unsigned int count);
+
+	// body factories, positions and dimensions are in Box2D units and angles in radians.
+	// The handle is valid as soon as the call returns, even if the body is created later
+	// by the simulation thread
+	BodyHandle createBox(const glm::vec2& position, const glm::vec2& dimensions, const float rotation, const glm::vec3& color = glm::vec3(1.0f));
+	BodyHandle createWall(const glm::vec2& position, const glm::vec2& dimensions, const float rotation, const glm::vec3& color = glm::vec3(1.0f));
+	BodyHandle createCircle(const glm::vec2& position, const float radius, const b2BodyType type, const glm::vec3& color = glm::vec3(1.0f));
+	void destroyObject(BodyHandle handle);
+	// teleports a body, e.g. when it is moved in the canva
+	void setPosition(BodyHandle handle, const b2Vec2& position);
+	void setRotation(BodyHandle handle, const float angle);
+	float getRenderScale() const { return RENDER_SCALE; }
+
+	// fixed timestep stepping: the frame time is accumulated and consumed in steps of
+	// exactly m_time_step, so the physics rate does not depend on the display rate
+	void setTimeStep(const float time_step);
+	float getTimeStep() const { return m_time_step; }
+	void setMaxSubSteps(const int max_sub_steps);
+	// advances the simulation by frame_time seconds and returns the number of steps taken.
+	// At most m_max_sub_steps are run per call, the remaining time is dropped
+	int update(float frame_time);
+	// performs a single fixed step, saving the previous transforms for interpolation
+	void step();
+	// Parallel stepping. Bodies that may touch before the next regroup are kept in the
+	// same world, and the worlds are stepped concurrently on worker_count threads.
+	// The assignment does not depend on the thread timing, so runs with the same worker
+	// count are repeatable, but they differ from stepping a single world, see
+	// partitionBodies. 0 uses one worker per hardware core, 1 steps a single world.
+	// The GJK/TOI statistics counters of Box2D are globals incremented by every world,
+	// they are not reliable while the worlds are stepped in parallel
+	void setWorkerCount(unsigned int worker_count);
+	unsigned int getWorkerCount() const { return m_worker_count; }
+	// b2Contact fills its table of contact functions the first time a contact is created,
+	// without any locking. Called on one thread before worlds are stepped concurrently
+	static void initializeContactRegisters();
+	// fraction of a step left in the accumulator, used to blend previous and current poses
+	float getInterpolationAlpha() const { return m_accumulator / m_time_step; }
+	// moves the b2Profile of the steps taken since the last call into the profiler's
+	// current frame. Safe to call while the simulation thread runs
+	void collectProfile(Profiler& profiler);
+
+	// simulation thread: steps the world in real time while simulate is set
+	void startThread();
+	// applies the pending commands and joins the thread
+	void stopThread();
+	bool isThreadRunning() const { return m_thread.joinable(); }
+	// copies the bodies into the next snapshot. Called by the simulation thread, or by
+	// the owner of the world when it is stepped without the thread
+	void publishSnapshot();
+	// latest published snapshot, only to be called from one (the render) thread
+	const BodySnapshot& acquireSnapshot();
+	// world-space area shown by the renderer. Once set, snapshots only hold the bodies
+	// whose fixtures overlap it, found through the broadphase with b2World::QueryAABB
+	void setViewBounds(const b2AABB& bounds);
+	// snapshots hold every body again
+	void clearViewBounds();
+
+	// Batched scene queries for gameplay code. A batch runs on the simulation thread
+	// (the call waits for it), split in chunks over a thread pool of the queries. The
+	// pool is separate from the stepping workers of setWorkerCount, so the queries run
+	// in parallel without partitioning the world.
+	// threads of the query pool, 0 (the default) uses one per hardware core. The pool is
+	// created by the first batch with more than one chunk
+	void setQueryThreadCount(unsigned int thread_count);
+	// closest hit of every ray of the batch
+	void castRays(RayCastBatch& batch);
+	// bodies overlapping every box of the batch
+	void queryBoxes(BoxQueryBatch& batch);
+
+	// copies the state of the static bodies, e.g. for the particle colliders. Waits for
+	// the simulation thread
+	void getStaticBodies(std::vector<BodyState>& bodies);
+
+	// Saved world state, captured when the simulation starts and restored by Reset
+	// without destroying and recreating the bodies. Any edit of the bodies discards it.
+	void captureState();
+	// puts every body, the gravity and the time step back into the captured state, and
+	// zeroes the impulses of the contacts still in the worlds so the next step starts
+	// cold. Returns false, and does nothing, if there is no captured state.
+	// The replay is close to the first run but not bit for bit: the contacts that
+	// survive keep their place in the contact list and the broadphase tree keeps the
+	// shape it grew during the run, so the pairs, islands and solver order differ from
+	// those of a freshly built world. loadState rebuilds the worlds, so a state file
+	// runs the same way every time it is loaded
+	bool restoreState();
+	bool hasCapturedState() const { return m_state_valid; }
+	// writes the captured state to file. Returns false if there is none or the file can't be written
+	bool saveState(const std::string& filePath);
+	// replaces the bodies, gravity and time step with the ones of a state file, which
+	// also becomes the captured state. Returns false if the file can't be read
+	bool loadState(const std::string& filePath);
 
 private:
 	b2Vec2 m_gravity;
+	bool m_gravity_enabled; // enableGravity, as seen by the simulation thread
+	float m_restitution; // negative: per-kind defaults
+	float m_time_step;
+	int m_max_sub_steps;
+	float m_max_frame_time; // frame times above this are clamped (e.g. after a breakpoint)
+	float m_accumulator;
+	int m_velocity_iterations;
+	int m_position_iterations;
+	std::atomic<BodyHandle> m_next_handle; // handles are handed out by the calling thread
+	unsigned long long m_step_count;
+	std::chrono::steady_clock::time_point m_last_step_time;
 	float RENDER_SCALE;
 	unsigned int SCREEN_WIDTH;
 	unsigned int SCREEN_HEIGHT;
 	std::mt19937 rand_generator;
-};
 
+	// b2Profile of the steps not collected yet
+	std::mutex m_profile_mutex;
+	b2Profile m_profile_sum;
+	unsigned int m_profiled_steps;
+
+	std::thread m_thread;
+	std::mutex m_command_mutex;
+	std::condition_variable m_wake; // new command or stop request
+	std::vector<std::function<void()>> m_commands;
+	bool m_quit;
+	TripleBuffer<BodySnapshot> m_snapshots;
+	bool m_cull; // only the bodies in m_view_bounds go into the snapshots
+	b2AABB m_view_bounds;
+	std::vector<unsigned int> m_visible; // store indices of the bodies in view
+
+	// parallel stepping, the partitions are the worlds stepped next to m_world
+	std::atomic<unsigned int> m_worker_count;
+	std::unique_ptr<ThreadPool> m_pool;
+	std::vector<b2World*> m_partitions;
+	std::vector<b2Body*> m_static_replicas; // copies of the static bodies of m_world in the partitions
+	bool m_partitions_dirty; // bodies were edited, or one left its group, since the last regroup
+	bool m_statics_dirty; // a static body was added, removed or moved: the replicas are stale
+	unsigned int m_steps_since_regroup;
+	std::vector<b2AABB> m_group_boxes; // box each body was grouped with, by store index
+	unsigned int m_query_thread_count;
+	std::unique_ptr<ThreadPool> m_query_pool; // runs the chunks of castRays/queryBoxes
+
+	std::mutex m_state_mutex; // m_state is written by the simulation thread and saved by the caller
+	WorldState m_state;
+	std::atomic<bool> m_state_valid; // tracked on the calling side, in command order
+
+	float getRestitution(const float default_restitution) const { return m_restitution < 0.0f ? default_restitution : m_restitution; }
+	// registers a newly created body under its handle, which buildBody stored in the body's user data
+	void addBody(BodyHandle handle, b2Body* body, BodyKind kind, const glm::vec2& dimensions, const glm::vec3& color);
+	// creates the body and fixture described by a body state in world, tagged with its handle
+	b2Body* buildBody(const BodyState& state, b2World* world);
+	// same in m_world, and registers it
+	void createBody(const BodyState& state);
+	unsigned int getWorldCount() const { return static_cast<unsigned int>(m_partitions.size()) + 1; }
+	b2World* getWorld(unsigned int index) const { return index == 0 ? m_world : m_partitions[index - 1]; }
+	// destroys the bodies of every world, including the static replicas
+	void destroyAllBodies();
+	// recreates the body at a store index in another world, keeping its state
+	void moveBody(unsigned int index, b2World* world);
+	// groups the bodies that may interact and assigns the groups to the worlds
+	void partitionBodies();
+	// true if a body may leave the box it was grouped with during the next step
+	bool hasBodyLeftGroup() const;
+	void rebuildStaticReplicas();
+	// in place if the world holds exactly the bodies of the state, otherwise by rebuilding
+	void applyState(const WorldState& state);
+	// replaces the worlds with new ones holding the bodies of the state
+	void rebuildFromState(const WorldState& state);
+	// runs the command now if there is no simulation thread, otherwise queues it
+	void execute(std::function<void()> command);
+	// same, but waits until the simulation thread has run it
+	void executeAndWait(std::function<void()> command);
+	// returns true if there were commands to run
+	bool runCommands();
+	// calls body(begin, end) for the chunks of [0, count), on the query pool if there is
+	// more than one
+	void forEachChunk(unsigned int count, unsigned int chunk_size, const std::function<void(unsigned int, unsigned int)>& body);
+	void threadLoop();
+};
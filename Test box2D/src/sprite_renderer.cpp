@@ -1,20 +1,38 @@
 #include "sprite_renderer.h"
+#include "render_state.h"
+
+#include <cstddef>
 
 SpriteRenderer::SpriteRenderer(Shader& shader)
 {
-	this->shader = shader;
+	this->shader = &shader;
+	this->initRenderData();
+}
+
+SpriteRenderer::SpriteRenderer(Shader& shader, Shader& batch_shader)
+{
+	this->shader = &shader;
+	this->batch_shader = &batch_shader;
 	this->initRenderData();
+	this->initBatchData();
 }
 
 SpriteRenderer::~SpriteRenderer()
 {
 	glDeleteVertexArrays(1, &this->quad_VAO);
+	glDeleteBuffers(1, &this->quad_VBO);
+	RenderState::forgetVertexArray(this->quad_VAO);
+	if (batching_enabled)
+	{
+		glDeleteVertexArrays(1, &this->batch_VAO);
+		glDeleteBuffers(1, &this->instance_VBO);
+		RenderState::forgetVertexArray(this->batch_VAO);
+	}
 }
 
 void SpriteRenderer::initRenderData() {
 	// configure VAO/VBO
 	// -----------------
-	unsigned int VBO;
 	float vertices[] = {
 		// pos	    // tex
 		0.0f, 0.0f, 0.0f, 0.0f,
@@ -24,17 +42,60 @@ void SpriteRenderer::initRenderData() {
 	};
 
 	glGenVertexArrays(1, &quad_VAO);
-	glGenBuffers(1, &VBO);
+	glGenBuffers(1, &quad_VBO);
 
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBindBuffer(GL_ARRAY_BUFFER, quad_VBO);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
-	glBindVertexArray(quad_VAO);
+	RenderState::bindVertexArray(quad_VAO);
 	glEnableVertexAttribArray(0);
 	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
 	
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
+	RenderState::bindVertexArray(0);
+}
+
+void SpriteRenderer::initBatchData() {
+	// configure the instanced VAO: attribute 0 is the shared quad, attributes
+	// 1 and 2 are streamed once per instance from instance_VBO
+	// -------------------------------------------------------------------------
+	instance_capacity = 1024;
+	glGenVertexArrays(1, &batch_VAO);
+	glGenBuffers(1, &instance_VBO);
+
+	RenderState::bindVertexArray(batch_VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, quad_VBO);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+
+	glBindBuffer(GL_ARRAY_BUFFER, instance_VBO);
+	glBufferData(GL_ARRAY_BUFFER, instance_capacity * sizeof(SpriteInstance), nullptr, GL_STREAM_DRAW);
+	// <vec2 position, vec2 size>
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)offsetof(SpriteInstance, position));
+	glVertexAttribDivisor(1, 1);
+	// <vec3 color, float rotation>
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)offsetof(SpriteInstance, color));
+	glVertexAttribDivisor(2, 1);
+	// <vec2 uv offset, vec2 uv scale>
+	glEnableVertexAttribArray(3);
+	glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)offsetof(SpriteInstance, uv));
+	glVertexAttribDivisor(3, 1);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	RenderState::bindVertexArray(0);
+	batching_enabled = true;
+}
+
+void SpriteRenderer::useShader() {
+	shader->use();
+	// resolve the per-sprite uniforms once per program
+	if (shader->ID != resolved_program) {
+		model_uniform = shader->getUniform("model");
+		color_uniform = shader->getUniform("spriteColor");
+		resolved_program = shader->ID;
+	}
 }
 
 void SpriteRenderer::drawSprite(Texture2D& texture, glm::vec2 position,
@@ -43,7 +104,7 @@ void SpriteRenderer::drawSprite(Texture2D& texture, glm::vec2 position,
 	// prepare tranformations
 	// ----------------------
 
-	shader.use();
+	useShader();
 	glm::mat4 model = glm::mat4(1.0f);
 	model = glm::translate(model, glm::vec3(position, 0.0f));
 
@@ -52,15 +113,15 @@ void SpriteRenderer::drawSprite(Texture2D& texture, glm::vec2 position,
 	model = glm::translate(model, glm::vec3(-0.5 * size.x, -0.5 * size.y, 0.0));
 	model = glm::scale(model, glm::vec3(size, 1.0f));
 	
-	shader.setMatrix4("model", model);
-	shader.setVector3f("spriteColor", color);
+	shader->setMatrix4(model_uniform, model);
+	shader->setVector3f(color_uniform, color);
 
-	glActiveTexture(GL_TEXTURE0);
+	RenderState::activeTexture(0);
 	texture.bind();
 
-	glBindVertexArray(quad_VAO);
+	// the VAO stays bound, the next sprite will most likely use it as well
+	RenderState::bindVertexArray(quad_VAO);
 	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-	glBindVertexArray(0);
 }
 
 void SpriteRenderer::drawSpriteNoTexture(glm::vec2 position,
@@ -69,7 +130,7 @@ void SpriteRenderer::drawSpriteNoTexture(glm::vec2 position,
 	// prepare tranformations
 	// ----------------------
 
-	shader.use();
+	useShader();
 	glm::mat4 model = glm::mat4(1.0f);
 	model = glm::translate(model, glm::vec3(position, 0.0f));
 
@@ -78,38 +139,103 @@ void SpriteRenderer::drawSpriteNoTexture(glm::vec2 position,
 	model = glm::translate(model, glm::vec3(-0.5 * size.x, -0.5 * size.y, 0.0));
 	model = glm::scale(model, glm::vec3(size, 1.0f));
 
-	shader.setMatrix4("model", model);
-	shader.setVector3f("spriteColor", color);
+	shader->setMatrix4(model_uniform, model);
+	shader->setVector3f(color_uniform, color);
 
-	glBindVertexArray(quad_VAO);
+	RenderState::bindVertexArray(quad_VAO);
 	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-	glBindVertexArray(0);
 }
 
-// Renders a sprite from position and size given by Box2D objects. The render_scale serves the 
-// purpose of scaling the box2D dimensions such that they are drawable on the viewPort. 
-void SpriteRenderer::drawSpriteBox2D(float render_scale, Texture2D& texture, glm::vec2 position,
+// Renders a sprite from position and size given by Box2D objects. They stay in Box2D units,
+// the view-projection of the camera scales them to the viewPort.
+void SpriteRenderer::drawSpriteBox2D(Texture2D& texture, glm::vec2 position,
 	glm::vec2 size, float rotate, glm::vec3 color) {
 	
 	// prepare tranformations
 	// ----------------------
-	glm::vec2 _position = render_scale * position;
-	glm::vec2 _size = render_scale * size;
-	shader.use();
+	useShader();
 	glm::mat4 model = glm::mat4(1.0f);
-	model = glm::translate(model, glm::vec3(_position, 0.0f));
+	model = glm::translate(model, glm::vec3(position, 0.0f));
 	model = glm::rotate(model, glm::radians(rotate), glm::vec3(0.0f, 0.0f, 1.0f));
-	model = glm::translate(model, glm::vec3(-0.5 * _size.x, -0.5 * _size.y, 0.0));
-	model = glm::scale(model, glm::vec3(_size, 1.0f));
+	model = glm::translate(model, glm::vec3(-0.5 * size.x, -0.5 * size.y, 0.0));
+	model = glm::scale(model, glm::vec3(size, 1.0f));
 
-	shader.setMatrix4("model", model);
-	shader.setVector3f("spriteColor", color);
+	shader->setMatrix4(model_uniform, model);
+	shader->setVector3f(color_uniform, color);
 
-	glActiveTexture(GL_TEXTURE0);
+	RenderState::activeTexture(0);
 	texture.bind();
 
-	glBindVertexArray(quad_VAO);
+	// the VAO stays bound, the next sprite will most likely use it as well
+	RenderState::bindVertexArray(quad_VAO);
 	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-	glBindVertexArray(0);
 
+}
+
+void SpriteRenderer::beginBatch()
+{
+	// keep the per-texture vectors around so their storage is reused every frame
+	for (auto& batch : batches)
+		batch.instances.clear();
+}
+
+void SpriteRenderer::batchSpriteBox2D(const Texture2D& texture, glm::vec2 position,
+	glm::vec2 size, float angle, glm::vec3 color) {
+
+	TextureRegion region;
+	region.texture_ID = texture.ID;
+	batchSpriteBox2D(region, position, size, angle, color);
+}
+
+void SpriteRenderer::batchSpriteBox2D(const TextureRegion& region, glm::vec2 position,
+	glm::vec2 size, float angle, glm::vec3 color) {
+
+	SpriteInstance instance;
+	instance.position = position;
+	instance.size = size;
+	instance.color = color;
+	instance.rotation = angle;
+	instance.uv = region.uv;
+	getBatch(region.texture_ID).instances.push_back(instance);
+}
+
+void SpriteRenderer::endBatch()
+{
+	batch_draw_calls = 0;
+	if (!batching_enabled)
+		return;
+
+	batch_shader->use();
+	RenderState::activeTexture(0);
+	RenderState::bindVertexArray(batch_VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, instance_VBO);
+	for (auto& batch : batches)
+	{
+		unsigned int count = static_cast<unsigned int>(batch.instances.size());
+		if (count == 0)
+			continue;
+		// grow the instance buffer geometrically, otherwise orphan it so that the
+		// driver does not have to wait for the previous draw to finish reading it
+		if (count > instance_capacity)
+			while (instance_capacity < count)
+				instance_capacity *= 2;
+		glBufferData(GL_ARRAY_BUFFER, instance_capacity * sizeof(SpriteInstance), nullptr, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(SpriteInstance), batch.instances.data());
+
+		RenderState::bindTexture(batch.texture_ID);
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+		batch_draw_calls++;
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	RenderState::bindVertexArray(0);
+}
+
+SpriteRenderer::SpriteBatch& SpriteRenderer::getBatch(unsigned int texture_ID)
+{
+	// only a handful of textures are in use, a linear search beats a map here
+	for (auto& batch : batches)
+		if (batch.texture_ID == texture_ID)
+			return batch;
+	batches.push_back(SpriteBatch{ texture_ID, {} });
+	return batches.back();
 }
\ No newline at end of file
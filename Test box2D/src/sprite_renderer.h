@@ -3,11 +3,27 @@
 
 #include "shader.hpp"
 #include "texture.h"
+#include "texture_atlas.h"
 #include <glm/glm.hpp>
+#include <vector>
 
+// per-instance data streamed to the instanced sprite shader. The layout
+// matches the instance attributes of vertex_instanced.vs
+struct SpriteInstance {
+	glm::vec2 position; // sprite center
+	glm::vec2 size;
+	glm::vec3 color;
+	float rotation; // radians
+	glm::vec4 uv; // <vec2 offset, vec2 scale> of the texture region
+};
+
+// The renderer keeps pointers to the shaders, which must outlive it: the shaders of the
+// ResourceManager are reloaded in place, and the renderer follows them
 class SpriteRenderer {
 public:
 	SpriteRenderer(Shader& shader);
+	// also enables the batch mode, which draws through the instanced batch_shader
+	SpriteRenderer(Shader& shader, Shader& batch_shader);
 	~SpriteRenderer();
 
 	void drawSprite(Texture2D& texture, glm::vec2 position,
@@ -16,14 +32,45 @@ public:
 	void drawSpriteNoTexture(glm::vec2 position,
 		glm::vec2 size = glm::vec2(10.0f, 10.0f), float rotate = 0.0f,
 		glm::vec3 color = glm::vec3(1.0f));
-	void drawSpriteBox2D(float renderScale, Texture2D& texture, glm::vec2 position,
+	// position and size in Box2D units, the camera maps them to the view
+	void drawSpriteBox2D(Texture2D& texture, glm::vec2 position,
 		glm::vec2 size = glm::vec2(10.0f, 10.0f), float rotate = 0.0f,
 		glm::vec3 color = glm::vec3(1.0f));
+
+	// batch mode: sprites added between beginBatch() and endBatch() are collected
+	// per texture and drawn with one instanced draw call per texture in endBatch().
+	// Sprites using regions of the same atlas page end up in the same draw call
+	void beginBatch();
+	// same as drawSpriteBox2D, but the rotation is given in radians as returned by b2Body::GetAngle()
+	void batchSpriteBox2D(const Texture2D& texture, glm::vec2 position,
+		glm::vec2 size, float angle, glm::vec3 color = glm::vec3(1.0f));
+	void batchSpriteBox2D(const TextureRegion& region, glm::vec2 position,
+		glm::vec2 size, float angle, glm::vec3 color = glm::vec3(1.0f));
+	void endBatch();
+	// number of instanced draw calls issued by the last endBatch()
+	unsigned int getBatchDrawCalls() const { return batch_draw_calls; }
 private:
-	Shader shader;
-	unsigned int quad_VAO;
+	// instances sharing the same texture
+	struct SpriteBatch {
+		unsigned int texture_ID;
+		std::vector<SpriteInstance> instances;
+	};
+
+	Shader* shader;
+	Shader* batch_shader = nullptr;
+	UniformHandle model_uniform, color_uniform;
+	unsigned int resolved_program = 0; // program the uniform handles belong to
+	unsigned int quad_VAO, quad_VBO;
+	unsigned int batch_VAO = 0, instance_VBO = 0;
+	unsigned int instance_capacity = 0; // size of instance_VBO, in instances
+	bool batching_enabled = false;
+	std::vector<SpriteBatch> batches;
+	unsigned int batch_draw_calls = 0;
 
 	void initRenderData();
+	// binds the sprite shader, and resolves its uniforms again if it was reloaded since
+	void useShader();
+	void initBatchData();
+	SpriteBatch& getBatch(unsigned int texture_ID);
 };
 #endif
-
@@ -0,0 +1,272 @@
+#include "text_renderer.h"
+#include "render_state.h"
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+
+namespace
+{
+	// width of the glyph atlas, its height is the next power of two that fits the glyphs
+	const unsigned int ATLAS_WIDTH = 512;
+	// empty pixels around each glyph, so that the mip levels don't bleed between glyphs
+	const unsigned int GLYPH_PADDING = 2;
+	// runs not drawn for this many batches are dropped once the cache holds MAX_RUNS
+	const unsigned int MAX_RUNS = 4096;
+	const unsigned int RUN_LIFETIME = 120;
+
+	unsigned int packColor(const glm::vec3& color)
+	{
+		glm::vec3 c = glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f;
+		return static_cast<unsigned int>(c.r) | static_cast<unsigned int>(c.g) << 8 | static_cast<unsigned int>(c.b) << 16 | 0xff000000u;
+	}
+}
+
+TextRenderer::TextRenderer(Shader& shader)
+{
+	this->shader = &shader;
+
+	float corners[] = {
+		0.0f, 0.0f,
+		0.0f, 1.0f,
+		1.0f, 0.0f,
+		1.0f, 1.0f
+	};
+	glGenVertexArrays(1, &quad_VAO);
+	glGenBuffers(1, &quad_VBO);
+	glGenBuffers(1, &instance_VBO);
+
+	RenderState::bindVertexArray(quad_VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, quad_VBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+
+	glBindBuffer(GL_ARRAY_BUFFER, instance_VBO);
+	glBufferData(GL_ARRAY_BUFFER, instance_capacity * sizeof(GlyphInstance), nullptr, GL_STREAM_DRAW);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(GlyphInstance), (void*)offsetof(GlyphInstance, rect));
+	glVertexAttribDivisor(1, 1);
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(GlyphInstance), (void*)offsetof(GlyphInstance, uv));
+	glVertexAttribDivisor(2, 1);
+	glEnableVertexAttribArray(3);
+	glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(GlyphInstance), (void*)offsetof(GlyphInstance, color));
+	glVertexAttribDivisor(3, 1);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	RenderState::bindVertexArray(0);
+}
+
+TextRenderer::~TextRenderer()
+{
+	glDeleteVertexArrays(1, &quad_VAO);
+	glDeleteBuffers(1, &quad_VBO);
+	glDeleteBuffers(1, &instance_VBO);
+	RenderState::forgetVertexArray(quad_VAO);
+	if (loaded)
+	{
+		glDeleteTextures(1, &atlas.ID);
+		RenderState::forgetTexture(atlas.ID);
+	}
+}
+
+bool TextRenderer::loadFont(const char* font_file, unsigned int pixel_height)
+{
+	FT_Library library;
+	if (FT_Init_FreeType(&library))
+	{
+		std::cout << "ERROR::FREETYPE: Could not init FreeType Library" << std::endl;
+		return false;
+	}
+	FT_Face face;
+	if (FT_New_Face(library, font_file, 0, &face))
+	{
+		std::cout << "ERROR::FREETYPE: Failed to load font " << font_file << std::endl;
+		FT_Done_FreeType(library);
+		return false;
+	}
+	FT_Set_Pixel_Sizes(face, 0, pixel_height);
+
+	// rasterize every glyph and place it on shelves as tall as their tallest glyph
+	const int glyph_count = LAST_GLYPH - FIRST_GLYPH + 1;
+	std::vector<std::vector<unsigned char>> bitmaps(glyph_count);
+	std::vector<glm::uvec2> placements(glyph_count);
+	unsigned int x = GLYPH_PADDING, y = GLYPH_PADDING, shelf_height = 0;
+	for (int i = 0; i < glyph_count; i++)
+	{
+		Glyph& glyph = glyphs[i];
+		glyph = Glyph();
+		if (FT_Load_Char(face, FIRST_GLYPH + i, FT_LOAD_RENDER))
+		{
+			std::cout << "ERROR::FREETYPE: Failed to load glyph " << char(FIRST_GLYPH + i) << std::endl;
+			continue;
+		}
+		const FT_Bitmap& bitmap = face->glyph->bitmap;
+		glyph.size = glm::vec2(bitmap.width, bitmap.rows);
+		glyph.bearing = glm::vec2(face->glyph->bitmap_left, face->glyph->bitmap_top);
+		glyph.advance = face->glyph->advance.x / 64.0f;
+		for (unsigned int row = 0; row < bitmap.rows; row++)
+			bitmaps[i].insert(bitmaps[i].end(), bitmap.buffer + row * bitmap.pitch, bitmap.buffer + row * bitmap.pitch + bitmap.width);
+
+		if (x + bitmap.width + GLYPH_PADDING > ATLAS_WIDTH)
+		{
+			x = GLYPH_PADDING;
+			y += shelf_height + GLYPH_PADDING;
+			shelf_height = 0;
+		}
+		placements[i] = glm::uvec2(x, y);
+		x += bitmap.width + GLYPH_PADDING;
+		shelf_height = std::max(shelf_height, bitmap.rows);
+	}
+	unsigned int atlas_height = 1;
+	while (atlas_height < y + shelf_height + GLYPH_PADDING)
+		atlas_height *= 2;
+
+	std::vector<unsigned char> pixels(ATLAS_WIDTH * atlas_height, 0);
+	for (int i = 0; i < glyph_count; i++)
+	{
+		Glyph& glyph = glyphs[i];
+		const unsigned int width = static_cast<unsigned int>(glyph.size.x);
+		for (unsigned int row = 0; row < static_cast<unsigned int>(glyph.size.y); row++)
+			std::copy_n(&bitmaps[i][row * width], width, &pixels[(placements[i].y + row) * ATLAS_WIDTH + placements[i].x]);
+		glyph.uv = glm::vec4(placements[i].x / float(ATLAS_WIDTH), placements[i].y / float(atlas_height),
+			glyph.size.x / ATLAS_WIDTH, glyph.size.y / atlas_height);
+	}
+
+	kerning.clear();
+	if (FT_HAS_KERNING(face))
+	{
+		kerning.resize(glyph_count * glyph_count);
+		for (int left = 0; left < glyph_count; left++)
+			for (int right = 0; right < glyph_count; right++)
+			{
+				FT_Vector delta;
+				FT_Get_Kerning(face, FT_Get_Char_Index(face, FIRST_GLYPH + left), FT_Get_Char_Index(face, FIRST_GLYPH + right), FT_KERNING_DEFAULT, &delta);
+				kerning[left * glyph_count + right] = delta.x / 64.0f;
+			}
+	}
+	this->pixel_height = static_cast<float>(pixel_height);
+	ascender = face->size->metrics.ascender / 64.0f;
+	descender = face->size->metrics.descender / 64.0f;
+	FT_Done_Face(face);
+	FT_Done_FreeType(library);
+
+	// trilinear filtering keeps the labels readable when the camera zooms out
+	if (loaded)
+	{
+		glDeleteTextures(1, &atlas.ID);
+		RenderState::forgetTexture(atlas.ID);
+		atlas = Texture2D();
+	}
+	atlas.internal_format = GL_RED;
+	atlas.image_format = GL_RED;
+	atlas.wrap_s = GL_CLAMP_TO_EDGE;
+	atlas.wrap_t = GL_CLAMP_TO_EDGE;
+	atlas.mipmaps = true;
+	atlas.generate(ATLAS_WIDTH, atlas_height, pixels.data());
+	runs.clear();
+	loaded = true;
+	return true;
+}
+
+const TextRenderer::TextRun& TextRenderer::getRun(const std::string& text)
+{
+	auto found = runs.find(text);
+	if (found != runs.end())
+	{
+		found->second.last_used = batch_count;
+		return found->second;
+	}
+
+	TextRun& run = runs[text];
+	const int glyph_count = LAST_GLYPH - FIRST_GLYPH + 1;
+	float pen = 0.0f;
+	int previous = -1;
+	for (char c : text)
+	{
+		// characters outside the atlas are drawn as spaces
+		const int index = c >= FIRST_GLYPH && c <= LAST_GLYPH ? c - FIRST_GLYPH : 0;
+		if (previous >= 0 && !kerning.empty())
+			pen += kerning[previous * glyph_count + index];
+		const Glyph& glyph = glyphs[index];
+		if (glyph.size.x > 0.0f && glyph.size.y > 0.0f)
+		{
+			run.rects.push_back(glm::vec4(pen + glyph.bearing.x, -glyph.bearing.y, glyph.size));
+			run.uvs.push_back(glyph.uv);
+		}
+		pen += glyph.advance;
+		previous = index;
+	}
+	run.width = pen;
+	run.last_used = batch_count;
+	return run;
+}
+
+void TextRenderer::beginBatch()
+{
+	instances.clear();
+	batch_count++;
+	if (runs.size() < MAX_RUNS)
+		return;
+	for (auto it = runs.begin(); it != runs.end();)
+	{
+		if (batch_count - it->second.last_used > RUN_LIFETIME)
+			it = runs.erase(it);
+		else
+			++it;
+	}
+}
+
+void TextRenderer::addText(const std::string& text, glm::vec2 position, float height, glm::vec3 color)
+{
+	if (!loaded || text.empty())
+		return;
+	const TextRun& run = getRun(text);
+	const float scale = height / pixel_height;
+	// the baseline is placed so that the line, from ascender to descender, is centered
+	const glm::vec2 origin(position.x - 0.5f * run.width * scale, position.y + 0.5f * (ascender + descender) * scale);
+	const unsigned int packed_color = packColor(color);
+	for (unsigned int i = 0; i < run.rects.size(); i++)
+	{
+		GlyphInstance instance;
+		instance.rect = glm::vec4(origin + glm::vec2(run.rects[i]) * scale, glm::vec2(run.rects[i].z, run.rects[i].w) * scale);
+		instance.uv = run.uvs[i];
+		instance.color = packed_color;
+		instances.push_back(instance);
+	}
+}
+
+float TextRenderer::measure(const std::string& text, float height)
+{
+	if (!loaded)
+		return 0.0f;
+	return getRun(text).width * height / pixel_height;
+}
+
+void TextRenderer::endBatch()
+{
+	if (!loaded || instances.empty())
+		return;
+	const unsigned int count = static_cast<unsigned int>(instances.size());
+	glBindBuffer(GL_ARRAY_BUFFER, instance_VBO);
+	// grow geometrically, otherwise orphan, as in SpriteRenderer::endBatch
+	while (instance_capacity < count)
+		instance_capacity *= 2;
+	glBufferData(GL_ARRAY_BUFFER, instance_capacity * sizeof(GlyphInstance), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(GlyphInstance), instances.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	shader->use();
+	RenderState::activeTexture(0);
+	atlas.bind();
+	RenderState::bindVertexArray(quad_VAO);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+	glDisable(GL_BLEND);
+	RenderState::bindVertexArray(0);
+}
@@ -0,0 +1,76 @@
+#ifndef TEXT_RENDERER_H
+#define TEXT_RENDERER_H
+
+#include "shader.hpp"
+#include "texture.h"
+#include <glm/glm.hpp>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// per-glyph instance data streamed to text_2d.vs
+struct GlyphInstance {
+	glm::vec4 rect; // <vec2 top-left, vec2 size> in world units
+	glm::vec4 uv; // <vec2 offset, vec2 scale> in the atlas
+	unsigned int color; // RGBA8
+};
+
+// Draws text in the scene, e.g. labels on the bodies, in Box2D units through the camera
+// block. The printable ASCII glyphs of a font are rasterized once with FreeType into a
+// single-channel atlas texture. The layout of each string (glyph quads, kerning and
+// width) is computed once and cached, so a label drawn every frame only costs a lookup,
+// and all the text added between beginBatch() and endBatch() goes out in one instanced
+// draw call. Like SpriteRenderer, it keeps a pointer to the shader, which must outlive it
+class TextRenderer {
+public:
+	TextRenderer(Shader& shader);
+	~TextRenderer();
+
+	// rasterizes the glyphs at pixel_height pixels, which is the resolution of the text
+	// up close. Returns false if FreeType can't load the font
+	bool loadFont(const char* font_file, unsigned int pixel_height);
+	bool isLoaded() const { return loaded; }
+
+	void beginBatch();
+	// text centered on position, with lines height world units tall
+	void addText(const std::string& text, glm::vec2 position, float height, glm::vec3 color = glm::vec3(1.0f));
+	// width in world units of text drawn at height
+	float measure(const std::string& text, float height);
+	void endBatch();
+	unsigned int getGlyphCount() const { return static_cast<unsigned int>(instances.size()); }
+	unsigned int getCachedRuns() const { return static_cast<unsigned int>(runs.size()); }
+private:
+	static const char FIRST_GLYPH = 32;
+	static const char LAST_GLYPH = 126;
+
+	struct Glyph {
+		glm::vec2 size; // bitmap size, in pixels
+		glm::vec2 bearing; // offset from the pen position to the top-left of the bitmap
+		float advance;
+		glm::vec4 uv;
+	};
+	// glyph quads of a string, in pixels from the start of its baseline
+	struct TextRun {
+		std::vector<glm::vec4> rects;
+		std::vector<glm::vec4> uvs;
+		float width;
+		unsigned int last_used; // batch in which it was last drawn
+	};
+
+	Shader* shader;
+	Texture2D atlas;
+	bool loaded = false;
+	float pixel_height = 0.0f;
+	float ascender = 0.0f, descender = 0.0f; // above and below the baseline, in pixels
+	Glyph glyphs[LAST_GLYPH - FIRST_GLYPH + 1];
+	std::vector<float> kerning; // between each pair of glyphs, empty if the font has none
+	std::unordered_map<std::string, TextRun> runs;
+	unsigned int batch_count = 0;
+	std::vector<GlyphInstance> instances;
+	unsigned int quad_VAO, quad_VBO, instance_VBO;
+	unsigned int instance_capacity = 1024;
+
+	const TextRun& getRun(const std::string& text);
+};
+
+#endif
@@ -1,33 +1,200 @@
 #include "texture.h"
+#include "render_state.h"
 
+#include <GLFW/glfw3.h>
+#include <algorithm>
 #include <iostream>
 
+namespace {
+	typedef void (APIENTRYP TexStorage2DProc)(GLenum target, GLsizei levels, GLenum internal_format, GLsizei width, GLsizei height);
+
+	// glTexStorage2D (GL 4.2 or ARB_texture_storage), fetched through GLFW on first use
+	// since the GL 3.3 glad loader does not provide it
+	TexStorage2DProc getTexStorage2D() {
+		static bool initialized = false;
+		static TexStorage2DProc tex_storage_2d = nullptr;
+		if (!initialized) {
+			initialized = true;
+			GLint major = 0, minor = 0;
+			glGetIntegerv(GL_MAJOR_VERSION, &major);
+			glGetIntegerv(GL_MINOR_VERSION, &minor);
+			if (major > 4 || (major == 4 && minor >= 2) || glfwExtensionSupported("GL_ARB_texture_storage"))
+				tex_storage_2d = reinterpret_cast<TexStorage2DProc>(glfwGetProcAddress("glTexStorage2D"));
+		}
+		return tex_storage_2d;
+	}
+
+	GLenum getSizedFormat(GLenum format) {
+		if (format == GL_RGB)
+			return GL_RGB8;
+		if (format == GL_RGBA)
+			return GL_RGBA8;
+		if (format == GL_RED)
+			return GL_R8;
+		return format;
+	}
+
+	// halves an image with a 2x2 box filter, odd sizes clamp to the last row/column
+	void downsample(const std::vector<unsigned char>& src, unsigned int width, unsigned int height, unsigned int channels, std::vector<unsigned char>& dst) {
+		unsigned int dst_width = std::max(width / 2, 1u), dst_height = std::max(height / 2, 1u);
+		dst.resize(static_cast<size_t>(dst_width) * dst_height * channels);
+		for (unsigned int y = 0; y < dst_height; y++) {
+			unsigned int y0 = std::min(2 * y, height - 1), y1 = std::min(2 * y + 1, height - 1);
+			for (unsigned int x = 0; x < dst_width; x++) {
+				unsigned int x0 = std::min(2 * x, width - 1), x1 = std::min(2 * x + 1, width - 1);
+				for (unsigned int c = 0; c < channels; c++) {
+					unsigned int sum = src[(static_cast<size_t>(y0) * width + x0) * channels + c] + src[(static_cast<size_t>(y0) * width + x1) * channels + c]
+						+ src[(static_cast<size_t>(y1) * width + x0) * channels + c] + src[(static_cast<size_t>(y1) * width + x1) * channels + c];
+					dst[(static_cast<size_t>(y) * dst_width + x) * channels + c] = static_cast<unsigned char>((sum + 2) / 4);
+				}
+			}
+		}
+	}
+}
+
 Texture2D::Texture2D() :
 	width(0), height(0),
 		wrap_s(GL_REPEAT), wrap_t(GL_REPEAT), internal_format(GL_RGB), image_format(GL_RGB), filter_min(GL_LINEAR),
-			filter_max(GL_LINEAR) {
+			filter_max(GL_LINEAR), mipmaps(false), levels(1), immutable(false) {
 	glGenTextures(1, &this->ID);
 }
 
 void Texture2D::generate(unsigned int width, unsigned int height, unsigned char* data) {
 	this->width = width;
 	this->height = height;
+	this->levels = mipmaps ? getLevelCount(width, height) : 1;
 	// create Texture
-	glBindTexture(GL_TEXTURE_2D, this->ID);
-	if (this->image_format == 6407)
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-	else if (this->image_format == 6408)
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+	RenderState::bindTexture(this->ID);
+	// RGB rows are not 4-byte aligned
+	glPixelStorei(GL_UNPACK_ALIGNMENT, this->image_format == GL_RGBA ? 4 : 1);
+	if (isCompressed()) {
+		// the driver compresses each level as it is uploaded. glGenerateMipmap does not work on
+		// compressed formats, so the chain is downsampled here
+		const unsigned int channels = this->image_format == GL_RGBA ? 4 : 3;
+		std::vector<unsigned char> level_pixels, next_level;
+		if (data != nullptr)
+			level_pixels.assign(data, data + static_cast<size_t>(width) * height * channels);
+		unsigned int level_width = width, level_height = height;
+		for (unsigned int level = 0; level < this->levels; level++) {
+			glTexImage2D(GL_TEXTURE_2D, level, this->internal_format, level_width, level_height, 0, this->image_format, GL_UNSIGNED_BYTE,
+				data != nullptr ? level_pixels.data() : nullptr);
+			if (data != nullptr && level + 1 < this->levels) {
+				downsample(level_pixels, level_width, level_height, channels, next_level);
+				level_pixels.swap(next_level);
+			}
+			level_width = std::max(level_width / 2, 1u);
+			level_height = std::max(level_height / 2, 1u);
+		}
+	}
+	else {
+		// data may also come from a bound pixel unpack buffer
+		GLint unpack_buffer = 0;
+		if (data == nullptr)
+			glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &unpack_buffer);
+		const bool has_pixels = data != nullptr || unpack_buffer != 0;
+		TexStorage2DProc tex_storage_2d = getTexStorage2D();
+		if (tex_storage_2d != nullptr) {
+			// immutable storage: every level allocated at once, with a sized format
+			tex_storage_2d(GL_TEXTURE_2D, this->levels, getSizedFormat(this->internal_format), width, height);
+			this->immutable = true;
+			if (has_pixels)
+				glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, this->image_format, GL_UNSIGNED_BYTE, data);
+		}
+		else {
+			glTexImage2D(GL_TEXTURE_2D, 0, getSizedFormat(this->internal_format), width, height, 0, this->image_format, GL_UNSIGNED_BYTE, data);
+		}
+		if (this->levels > 1 && has_pixels)
+			glGenerateMipmap(GL_TEXTURE_2D);
+	}
+	setParameters();
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	// undind texture
+	RenderState::bindTexture(0);
+}
 
+void Texture2D::generateCompressed(unsigned int width, unsigned int height, GLenum format, const std::vector<std::vector<unsigned char>>& level_data) {
+	this->width = width;
+	this->height = height;
+	this->internal_format = format;
+	this->levels = static_cast<unsigned int>(level_data.size());
+	RenderState::bindTexture(this->ID);
+	unsigned int level_width = width, level_height = height;
+	for (unsigned int level = 0; level < this->levels; level++) {
+		glCompressedTexImage2D(GL_TEXTURE_2D, level, format, level_width, level_height, 0,
+			static_cast<GLsizei>(level_data[level].size()), level_data[level].data());
+		level_width = std::max(level_width / 2, 1u);
+		level_height = std::max(level_height / 2, 1u);
+	}
+	setParameters();
+	RenderState::bindTexture(0);
+}
 
+bool Texture2D::update(unsigned int width, unsigned int height, unsigned char* data) {
+	if (width == this->width && height == this->height && !isCompressed()) {
+		RenderState::bindTexture(this->ID);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, this->image_format == GL_RGBA ? 4 : 1);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, this->image_format, GL_UNSIGNED_BYTE, data);
+		if (this->levels > 1)
+			glGenerateMipmap(GL_TEXTURE_2D);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		RenderState::bindTexture(0);
+		return true;
+	}
+	if (!this->immutable) {
+		generate(width, height, data);
+		return true;
+	}
+	// immutable storage can't be re-specified
+	glDeleteTextures(1, &this->ID);
+	RenderState::forgetTexture(this->ID);
+	glGenTextures(1, &this->ID);
+	this->immutable = false;
+	generate(width, height, data);
+	return false;
+}
+
+bool Texture2D::getCompressedLevels(std::vector<std::vector<unsigned char>>& level_data) const {
+	if (!isCompressed())
+		return false;
+	level_data.resize(this->levels);
+	RenderState::bindTexture(this->ID);
+	for (unsigned int level = 0; level < this->levels; level++) {
+		GLint size = 0;
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+		level_data[level].resize(size);
+		if (size > 0)
+			glGetCompressedTexImage(GL_TEXTURE_2D, level, level_data[level].data());
+	}
+	RenderState::bindTexture(0);
+	return true;
+}
+
+bool Texture2D::isCompressed() const {
+	return this->internal_format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || this->internal_format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+}
+
+void Texture2D::bind() const {
+	RenderState::bindTexture(this->ID);
+}
+
+bool Texture2D::isCompressionSupported() {
+	static const bool supported = glfwExtensionSupported("GL_EXT_texture_compression_s3tc") == GLFW_TRUE;
+	return supported;
+}
+
+unsigned int Texture2D::getLevelCount(unsigned int width, unsigned int height) {
+	unsigned int levels = 1;
+	for (unsigned int size = std::max(width, height); size > 1; size /= 2)
+		levels++;
+	return levels;
+}
+
+void Texture2D::setParameters() const {
 	// set Texture wrap and filter modes
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, this->wrap_s);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, this->wrap_t);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, this->filter_min);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, this->levels > 1 && this->filter_min == GL_LINEAR ? GL_LINEAR_MIPMAP_LINEAR : this->filter_min);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, this->filter_max);
-	// undind texture
-	glBindTexture(GL_TEXTURE_2D, 0);
-}
-void Texture2D::bind() const {
-	glBindTexture(GL_TEXTURE_2D, this->ID);
+	// a mutable texture is only complete with the levels it has
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, this->levels - 1);
 }
@@ -2,6 +2,15 @@
 #define TEXTURE_H
 
 #include <glad/glad.h>
+#include <vector>
+
+// S3TC formats (EXT_texture_compression_s3tc), missing from the 3.3 core headers
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
 
 class Texture2D {
 public:
@@ -9,18 +18,38 @@ public:
 	unsigned int ID;
 	unsigned int width, height;
 	// texture format
-	GLuint internal_format; // format of texture object
+	GLuint internal_format; // format of texture object: GL_RED/GL_RGB/GL_RGBA (stored as GL_R8/GL_RGB8/GL_RGBA8) or an S3TC format
 	GLuint image_format; //format of the loaded image
 	// texture configuration
 	unsigned int wrap_s; // wrapping mode on s axis
 	unsigned int wrap_t; // wrapping mode on t axis
 	unsigned int filter_min; // filtering mode if texture pixels < screen pixels 
 	unsigned int filter_max; // filtering mode if texture pixels < screen pixels 
+	bool mipmaps; // build the whole mip chain, a GL_LINEAR filter_min then becomes trilinear
+	unsigned int levels; // mip levels of the texture, set by generate
+	bool immutable; // storage allocated with glTexStorage2D, its size and format are fixed
 	Texture2D(); 
-	// generate texture from image data
+	// generate texture from image data. With a pixel unpack buffer bound, data is an offset in
+	// the buffer. The storage is immutable when glTexStorage2D is available, so a texture is
+	// generated only once. With an S3TC internal_format the driver compresses the levels
 	void generate(unsigned int Width, unsigned int Height, unsigned char* data);
+	// generate texture from already compressed mip levels, level 0 first, without decoding them
+	void generateCompressed(unsigned int width, unsigned int height, GLenum format, const std::vector<std::vector<unsigned char>>& level_data);
+	// replaces the image of a generated texture, in place when the size and format allow it.
+	// Returns false if the texture had to be re-created under a new ID
+	bool update(unsigned int width, unsigned int height, unsigned char* data);
+	// reads back the compressed mip levels of the texture, false if it is not compressed
+	bool getCompressedLevels(std::vector<std::vector<unsigned char>>& level_data) const;
+	bool isCompressed() const;
 	// binds the texture as the current active GL_TEXTURE_2D texture object
 	void bind() const;
+
+	// true if the driver supports the S3TC formats
+	static bool isCompressionSupported();
+	// number of levels of a full mip chain
+	static unsigned int getLevelCount(unsigned int width, unsigned int height);
+private:
+	void setParameters() const;
 };
 
-#endif
\ No newline at end of file
+#endif
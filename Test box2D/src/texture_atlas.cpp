@@ -0,0 +1,168 @@
+#include "texture_atlas.h"
+#include "render_state.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// imgui_draw.cpp compiles its own static copy of stb_rect_pack
+#define STB_RECT_PACK_IMPLEMENTATION
+#define STBRP_STATIC
+#include <imgui/imstb_rectpack.h>
+
+void TextureAtlas::addImage(const std::string& name, int width, int height, const unsigned char* pixels) {
+	PendingImage image;
+	image.name = name;
+	image.width = width;
+	image.height = height;
+	image.pixels.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+	pending.push_back(std::move(image));
+}
+
+void TextureAtlas::addImage(const std::string& name, int width, int height, std::vector<unsigned char>&& pixels) {
+	PendingImage image;
+	image.name = name;
+	image.width = width;
+	image.height = height;
+	image.pixels = std::move(pixels);
+	pending.push_back(std::move(image));
+}
+
+bool TextureAtlas::build(int page_size, int padding) {
+	const bool all_packed = pack(page_size, padding);
+	while (!staged.empty())
+		uploadStagedPage([](Texture2D& page, std::vector<unsigned char>& pixels) { page.generate(page.width, page.height, pixels.data()); });
+	return all_packed;
+}
+
+bool TextureAtlas::pack(int page_size, int padding) {
+	this->padding = padding;
+	this->page_size = page_size;
+	std::vector<stbrp_rect> rects;
+	bool all_packed = true;
+	for (unsigned int i = 0; i < pending.size(); i++) {
+		stbrp_rect rect;
+		rect.id = static_cast<int>(i);
+		rect.w = pending[i].width + 2 * padding;
+		rect.h = pending[i].height + 2 * padding;
+		if (rect.w > page_size || rect.h > page_size) {
+			std::cout << "ERROR::ATLAS: Image " << pending[i].name << " does not fit in a " << page_size << "x" << page_size << " page" << std::endl;
+			all_packed = false;
+			continue;
+		}
+		rects.push_back(rect);
+	}
+
+	std::vector<stbrp_node> nodes(page_size);
+	// every pass fills one page with as many of the remaining rectangles as possible
+	while (!rects.empty()) {
+		stbrp_context context;
+		stbrp_init_target(&context, page_size, page_size, nodes.data(), static_cast<int>(nodes.size()));
+		stbrp_pack_rects(&context, rects.data(), static_cast<int>(rects.size()));
+
+		std::vector<unsigned char> page_pixels(static_cast<size_t>(page_size) * page_size * 4, 0);
+		Texture2D page;
+		// the size the page is generated with, see uploadStagedPage
+		page.width = page_size;
+		page.height = page_size;
+		page.internal_format = GL_RGBA;
+		page.image_format = GL_RGBA;
+		page.wrap_s = GL_CLAMP_TO_EDGE;
+		page.wrap_t = GL_CLAMP_TO_EDGE;
+
+		std::vector<stbrp_rect> remaining;
+		for (const stbrp_rect& rect : rects) {
+			if (!rect.was_packed) {
+				remaining.push_back(rect);
+				continue;
+			}
+			const PendingImage& image = pending[rect.id];
+			blit(page_pixels, page_size, image, rect.x, rect.y, padding);
+
+			TextureRegion region;
+			region.texture_ID = page.ID;
+			region.uv = glm::vec4(
+				static_cast<float>(rect.x + padding) / page_size, static_cast<float>(rect.y + padding) / page_size,
+				static_cast<float>(image.width) / page_size, static_cast<float>(image.height) / page_size);
+			regions[image.name] = region;
+			placements[image.name] = { static_cast<unsigned int>(pages.size()), rect.x, rect.y, image.width, image.height };
+		}
+		pages.push_back(page);
+		staged.push_back(std::move(page_pixels));
+		rects.swap(remaining);
+	}
+	pending.clear();
+	return all_packed;
+}
+
+void TextureAtlas::uploadStagedPage(const std::function<void(Texture2D&, std::vector<unsigned char>&)>& upload) {
+	if (staged.empty())
+		return;
+	upload(pages[pages.size() - staged.size()], staged.front());
+	staged.erase(staged.begin());
+}
+
+bool TextureAtlas::updateImage(const std::string& name, int width, int height, const unsigned char* pixels) {
+	auto it = placements.find(name);
+	if (it == placements.end() || it->second.width != width || it->second.height != height)
+		return false;
+	const Placement& placement = it->second;
+	if (!isUploaded(placement.page)) {
+		// the page still waits for its upload, which will carry the new pixels
+		PendingImage image;
+		image.width = width;
+		image.height = height;
+		image.pixels.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+		blit(staged[placement.page + staged.size() - pages.size()], page_size, image, placement.x, placement.y, padding);
+		return true;
+	}
+	// extrude the borders as build() does, into a buffer the size of the padded rectangle
+	PendingImage image;
+	image.name = name;
+	image.width = width;
+	image.height = height;
+	image.pixels.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+	const int padded_width = width + 2 * padding, padded_height = height + 2 * padding;
+	std::vector<unsigned char> padded(static_cast<size_t>(padded_width) * padded_height * 4);
+	blit(padded, padded_width, image, 0, 0, padding);
+
+	pages[placement.page].bind();
+	glTexSubImage2D(GL_TEXTURE_2D, 0, placement.x, placement.y, padded_width, padded_height, GL_RGBA, GL_UNSIGNED_BYTE, padded.data());
+	RenderState::bindTexture(0);
+	return true;
+}
+
+bool TextureAtlas::getRegion(const std::string& name, TextureRegion* region) const {
+	auto it = regions.find(name);
+	if (it == regions.end() || !isUploaded(placements.at(name).page))
+		return false;
+	*region = it->second;
+	return true;
+}
+
+void TextureAtlas::clear() {
+	for (auto& page : pages) {
+		glDeleteTextures(1, &page.ID);
+		RenderState::forgetTexture(page.ID);
+	}
+	pages.clear();
+	regions.clear();
+	placements.clear();
+	pending.clear();
+	staged.clear();
+}
+
+void TextureAtlas::blit(std::vector<unsigned char>& page, int page_size, const PendingImage& image, int x, int y, int padding) {
+	// every destination pixel of the padded rectangle reads the nearest source pixel,
+	// which copies the image and extrudes its borders at the same time
+	for (int row = 0; row < image.height + 2 * padding; row++) {
+		int src_row = std::min(std::max(row - padding, 0), image.height - 1);
+		unsigned char* dst = &page[(static_cast<size_t>(y + row) * page_size + x) * 4];
+		const unsigned char* src = &image.pixels[static_cast<size_t>(src_row) * image.width * 4];
+		for (int col = 0; col < padding; col++)
+			std::memcpy(dst + col * 4, src, 4);
+		std::memcpy(dst + padding * 4, src, static_cast<size_t>(image.width) * 4);
+		for (int col = 0; col < padding; col++)
+			std::memcpy(dst + (padding + image.width + col) * 4, src + (image.width - 1) * 4, 4);
+	}
+}
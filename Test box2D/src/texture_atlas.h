@@ -0,0 +1,76 @@
+#ifndef TEXTURE_ATLAS_H
+#define TEXTURE_ATLAS_H
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "texture.h"
+
+// A sub-rectangle of a texture: the GL texture holding it and the offset/scale
+// that map the [0, 1] texture coordinates of a sprite onto the sub-rectangle
+struct TextureRegion {
+	unsigned int texture_ID = 0;
+	glm::vec4 uv = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f); // <vec2 offset, vec2 scale>
+};
+
+// Packs several RGBA images into one or more large textures ("pages"), so sprites
+// using different images can be drawn without switching texture. Images are
+// packed with stb_rect_pack and their borders are extruded into the padding to
+// avoid bleeding between neighbours when filtering.
+class TextureAtlas {
+public:
+	// queues an RGBA8 image for packing, the pixels are copied
+	void addImage(const std::string& name, int width, int height, const unsigned char* pixels);
+	// same as above, taking over the pixels of an already decoded image
+	void addImage(const std::string& name, int width, int height, std::vector<unsigned char>&& pixels);
+	// packs the queued images into page_size x page_size textures and uploads them. Images
+	// that do not fit in a page are skipped. Returns false if any image was skipped
+	bool build(int page_size = 2048, int padding = 2);
+	// same packing, but the pages are only uploaded by uploadStagedPage(), so that the
+	// uploads can be spread over several frames. The regions of a page are not returned
+	// until it is uploaded
+	bool pack(int page_size = 2048, int padding = 2);
+	// number of packed pages waiting for their upload
+	unsigned int getStagedPageCount() const { return static_cast<unsigned int>(staged.size()); }
+	// uploads the next staged page: upload must generate the page texture from the
+	// page_size x page_size RGBA8 pixels. Does nothing if no page is staged
+	void uploadStagedPage(const std::function<void(Texture2D&, std::vector<unsigned char>&)>& upload);
+	// replaces the pixels of a packed image with an RGBA8 image of the same size, in place.
+	// Returns false if the image is not in the atlas or its size changed, since the atlas
+	// is not re-packed
+	bool updateImage(const std::string& name, int width, int height, const unsigned char* pixels);
+	// retrieves the region of a packed image. Returns false if the image is not in the atlas
+	bool getRegion(const std::string& name, TextureRegion* region) const;
+	const std::vector<Texture2D>& getPages() const { return pages; }
+	// frees the GL textures of the pages
+	void clear();
+private:
+	struct PendingImage {
+		std::string name;
+		int width, height;
+		std::vector<unsigned char> pixels;
+	};
+	// where a packed image lies, its padded rectangle starting at (x, y)
+	struct Placement {
+		unsigned int page;
+		int x, y, width, height;
+	};
+	std::vector<PendingImage> pending;
+	std::vector<Texture2D> pages;
+	// pixels of the last pages, packed but not uploaded yet, in page order
+	std::vector<std::vector<unsigned char>> staged;
+	std::map<std::string, TextureRegion> regions;
+	std::map<std::string, Placement> placements;
+	int padding = 0; // padding of the last build
+	int page_size = 0; // page size of the last build
+
+	bool isUploaded(unsigned int page) const { return page + staged.size() < pages.size(); }
+
+	// copies an image into a page at (x, y) and extrudes its borders by padding pixels
+	static void blit(std::vector<unsigned char>& page, int page_size, const PendingImage& image, int x, int y, int padding);
+};
+
+#endif
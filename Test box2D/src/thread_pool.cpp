@@ -0,0 +1,90 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+
+ThreadPool::ThreadPool(unsigned int thread_count)
+    : m_running(0), m_quit(false)
+{
+    if (thread_count == 0)
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    m_threads.reserve(thread_count);
+    for (unsigned int i = 0; i < thread_count; i++)
+        m_threads.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_task_available.notify_all();
+    for (auto& thread : m_threads)
+        thread.join();
+}
+
+void ThreadPool::enqueue(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.push_back(std::move(task));
+    }
+    m_task_available.notify_one();
+}
+
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this] { return m_tasks.empty() && m_running == 0; });
+}
+
+void ThreadPool::parallelFor(int count, const std::function<void(int)>& body)
+{
+    if (count <= 0)
+        return;
+    // one task per worker pulling indices from a shared counter, instead of one
+    // task per index, keeps the queue traffic independent from count. Completion is
+    // tracked locally so that unrelated tasks in the queue are not waited for
+    std::atomic<int> next(0);
+    int workers = std::min(count, static_cast<int>(m_threads.size()));
+    int remaining = workers;
+    std::mutex done_mutex;
+    std::condition_variable done;
+    for (int w = 0; w < workers; w++)
+    {
+        enqueue([&, count] {
+            for (int i = next++; i < count; i = next++)
+                body(i);
+            std::lock_guard<std::mutex> lock(done_mutex);
+            if (--remaining == 0)
+                done.notify_one();
+        });
+    }
+    std::unique_lock<std::mutex> lock(done_mutex);
+    done.wait(lock, [&remaining] { return remaining == 0; });
+}
+
+void ThreadPool::workerLoop()
+{
+    for (;;)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_task_available.wait(lock, [this] { return m_quit || !m_tasks.empty(); });
+            if (m_quit && m_tasks.empty())
+                return;
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+            m_running++;
+        }
+        task();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_running--;
+            if (m_tasks.empty() && m_running == 0)
+                m_idle.notify_all();
+        }
+    }
+}
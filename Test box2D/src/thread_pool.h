@@ -0,0 +1,43 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads consuming a FIFO queue of tasks. The pool is not
+// tied to Box2D or OpenGL: tasks must not touch the GL context, which is only
+// current on the main thread.
+class ThreadPool {
+public:
+	// thread_count = 0 uses one thread per hardware core
+	explicit ThreadPool(unsigned int thread_count = 0);
+	~ThreadPool();
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// queues a task, returns immediately
+	void enqueue(std::function<void()> task);
+	// blocks until every queued task has finished, including tasks queued by other callers
+	void wait();
+	// runs body(i) for i in [0, count) on the workers and blocks until all are done.
+	// Indices are handed out one at a time, so uneven items balance across threads
+	void parallelFor(int count, const std::function<void(int)>& body);
+	unsigned int getThreadCount() const { return static_cast<unsigned int>(m_threads.size()); }
+
+private:
+	std::vector<std::thread> m_threads;
+	std::deque<std::function<void()>> m_tasks;
+	std::mutex m_mutex;
+	std::condition_variable m_task_available;
+	std::condition_variable m_idle;
+	unsigned int m_running; // tasks taken from the queue and not finished yet
+	bool m_quit;
+
+	void workerLoop();
+};
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+// Lock-free single producer / single consumer triple buffer. The writer fills its
+// back buffer and publishes it, the reader picks up the most recently published one.
+// Neither side ever waits for the other: the writer never overwrites the buffer
+// being read, and the reader skips intermediate buffers it was too slow to see.
+//
+// The index of the buffer in the middle (published, not yet read) is swapped
+// atomically, the FRESH bit marks that it holds data the reader hasn't taken yet.
+template <typename T>
+class TripleBuffer {
+public:
+	TripleBuffer() : m_back(0), m_front(1), m_middle(2) {}
+	TripleBuffer(const TripleBuffer&) = delete;
+	TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+	// writer side
+	T& getWriteBuffer() { return m_buffers[m_back]; }
+	void publish()
+	{
+		m_back = m_middle.exchange(m_back | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+	}
+
+	// reader side: switches to the last published buffer, returns false if nothing
+	// new was published since the previous call
+	bool update()
+	{
+		if ((m_middle.load(std::memory_order_relaxed) & FRESH) == 0)
+			return false;
+		m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX_MASK;
+		return true;
+	}
+	const T& getReadBuffer() const { return m_buffers[m_front]; }
+
+private:
+	static const unsigned int INDEX_MASK = 3;
+	static const unsigned int FRESH = 4;
+
+	T m_buffers[3];
+	unsigned int m_back; // owned by the writer
+	unsigned int m_front; // owned by the reader
+	std::atomic<unsigned int> m_middle;
+};
+
+#endif
@@ -0,0 +1,69 @@
+#include "world_batch.h"
+
+#include <chrono>
+
+WorldBatch::WorldBatch(ThreadPool& pool, const float render_scale)
+    : m_pool(pool), m_render_scale(render_scale)
+{
+}
+
+int WorldBatch::addWorld(const CanvasShapes& shapes, const WorldConfig& config)
+{
+    std::unique_ptr<SimulationManager> world(new SimulationManager(m_render_scale, 0, 0));
+    world->setGravity(config.gravity);
+    world->setRestitution(config.restitution);
+    world->setTimeStep(config.time_step);
+    // the handles written back by createCanvasObjects belong to this world only
+    CanvasShapes world_shapes = shapes;
+    createCanvasObjects(*world, world_shapes);
+
+    m_worlds.push_back(std::move(world));
+    m_configs.push_back(config);
+    m_results.push_back(WorldResult());
+    return size() - 1;
+}
+
+void WorldBatch::run(const int steps)
+{
+    SimulationManager::initializeContactRegisters();
+    m_pool.parallelFor(size(), [this, steps](int index) {
+        SimulationManager& world = *m_worlds[index];
+        WorldResult& result = m_results[index];
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < steps; i++)
+            world.step();
+        auto end = std::chrono::steady_clock::now();
+
+        result.steps += steps;
+        result.seconds += std::chrono::duration<double>(end - start).count();
+        result.bodies = world.m_world->GetBodyCount();
+        result.awake_bodies = 0;
+        result.kinetic_energy = 0.0f;
+        b2Vec2 weighted_center = b2Vec2_zero;
+        float total_mass = 0.0f;
+        for (b2Body* b = world.m_world->GetBodyList(); b != nullptr; b = b->GetNext())
+        {
+            if (b->IsAwake())
+                result.awake_bodies++;
+            if (b->GetType() != b2_dynamicBody)
+                continue;
+            float mass = b->GetMass();
+            float speed = b->GetLinearVelocity().Length();
+            float angular_velocity = b->GetAngularVelocity();
+            // GetInertia() is about the body origin, move it to the center of mass
+            float central_inertia = b->GetInertia() - mass * b2Dot(b->GetLocalCenter(), b->GetLocalCenter());
+            result.kinetic_energy += 0.5f * mass * speed * speed + 0.5f * central_inertia * angular_velocity * angular_velocity;
+            weighted_center += mass * b->GetWorldCenter();
+            total_mass += mass;
+        }
+        result.center_of_mass = total_mass > 0.0f ? (1.0f / total_mass) * weighted_center : b2Vec2_zero;
+    });
+}
+
+void WorldBatch::clear()
+{
+    m_worlds.clear();
+    m_configs.clear();
+    m_results.clear();
+}
@@ -0,0 +1,54 @@
+#ifndef WORLD_BATCH_H
+#define WORLD_BATCH_H
+
+#include <box2d/box2d.h>
+#include <memory>
+#include <vector>
+#include "canvas.h"
+#include "simulation_manager.h"
+#include "thread_pool.h"
+
+// settings of one world of a batch
+struct WorldConfig {
+	b2Vec2 gravity = b2Vec2(0.0f, 10.0f);
+	float restitution = -1.0f; // negative: keep the per-kind defaults
+	float time_step = 1.0f / 60.0f;
+};
+
+// state of one world after WorldBatch::run
+struct WorldResult {
+	int steps = 0;
+	double seconds = 0.0; // wall time spent stepping this world
+	int bodies = 0;
+	int awake_bodies = 0;
+	b2Vec2 center_of_mass = b2Vec2_zero; // of the dynamic bodies
+	float kinetic_energy = 0.0f;
+};
+
+// N independent SimulationManagers built from the same canva and stepped concurrently
+// on a thread pool, e.g. for gravity or restitution sweeps. Worlds share no state,
+// so each one is stepped by a single thread and no locking is needed.
+class WorldBatch {
+public:
+	WorldBatch(ThreadPool& pool, const float render_scale);
+
+	// creates a world populated with the canva shapes, returns its index
+	int addWorld(const CanvasShapes& shapes, const WorldConfig& config);
+	// steps every world steps times, one world per task, and fills in the results
+	void run(const int steps);
+	void clear();
+
+	int size() const { return static_cast<int>(m_worlds.size()); }
+	SimulationManager& getWorld(int index) { return *m_worlds[index]; }
+	const WorldConfig& getConfig(int index) const { return m_configs[index]; }
+	const WorldResult& getResult(int index) const { return m_results[index]; }
+
+private:
+	ThreadPool& m_pool;
+	float m_render_scale;
+	std::vector<std::unique_ptr<SimulationManager>> m_worlds;
+	std::vector<WorldConfig> m_configs;
+	std::vector<WorldResult> m_results;
+};
+
+#endif
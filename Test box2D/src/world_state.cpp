@@ -0,0 +1,167 @@
+#include "world_state.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include "binary_io.h"
+#include "mapped_file.h"
+
+// flags of a body state record
+const unsigned char STATE_AWAKE = 1 << 0;
+const unsigned char STATE_ENABLED = 1 << 1;
+const unsigned char STATE_FIXED_ROTATION = 1 << 2;
+const unsigned char STATE_BULLET = 1 << 3;
+const unsigned char STATE_SLEEPING_ALLOWED = 1 << 4;
+
+BodyState WorldState::captureBody(BodyHandle handle, BodyKind kind, const glm::vec2& dimensions, const glm::vec3& color, const b2Body* body)
+{
+    BodyState state;
+    state.handle = handle;
+    state.kind = kind;
+    state.type = body->GetType();
+    state.position = body->GetPosition();
+    state.angle = body->GetAngle();
+    state.linear_velocity = body->GetLinearVelocity();
+    state.angular_velocity = body->GetAngularVelocity();
+    state.awake = body->IsAwake();
+    state.enabled = body->IsEnabled();
+    state.fixed_rotation = body->IsFixedRotation();
+    state.bullet = body->IsBullet();
+    state.sleeping_allowed = body->IsSleepingAllowed();
+    state.linear_damping = body->GetLinearDamping();
+    state.angular_damping = body->GetAngularDamping();
+    state.gravity_scale = body->GetGravityScale();
+    state.dimensions = dimensions;
+    state.color = color;
+    const b2Fixture* fixture = body->GetFixtureList();
+    state.density = fixture ? fixture->GetDensity() : 0.0f;
+    state.friction = fixture ? fixture->GetFriction() : 0.0f;
+    state.restitution = fixture ? fixture->GetRestitution() : 0.0f;
+    state.restitution_threshold = fixture ? fixture->GetRestitutionThreshold() : 0.0f;
+    return state;
+}
+
+static void encodeBodyState(const BodyState& state, unsigned char* out)
+{
+    std::memset(out, 0, WORLD_STATE_RECORD_SIZE);
+    putU32(out, state.handle);
+    out[4] = static_cast<unsigned char>(state.kind);
+    out[5] = static_cast<unsigned char>(state.type);
+    out[6] = (state.awake ? STATE_AWAKE : 0) | (state.enabled ? STATE_ENABLED : 0) | (state.fixed_rotation ? STATE_FIXED_ROTATION : 0) |
+        (state.bullet ? STATE_BULLET : 0) | (state.sleeping_allowed ? STATE_SLEEPING_ALLOWED : 0);
+    putF32(out + 8, state.position.x);
+    putF32(out + 12, state.position.y);
+    putF32(out + 16, state.angle);
+    putF32(out + 20, state.linear_velocity.x);
+    putF32(out + 24, state.linear_velocity.y);
+    putF32(out + 28, state.angular_velocity);
+    putF32(out + 32, state.dimensions.x);
+    putF32(out + 36, state.dimensions.y);
+    putF32(out + 40, state.color.r);
+    putF32(out + 44, state.color.g);
+    putF32(out + 48, state.color.b);
+    putF32(out + 52, state.density);
+    putF32(out + 56, state.friction);
+    putF32(out + 60, state.restitution);
+    putF32(out + 64, state.restitution_threshold);
+    putF32(out + 68, state.linear_damping);
+    putF32(out + 72, state.angular_damping);
+    putF32(out + 76, state.gravity_scale);
+}
+
+// returns false if the record is malformed
+static bool decodeBodyState(const unsigned char* in, BodyState* state)
+{
+    if (in[4] >= static_cast<unsigned char>(BodyKind::COUNT) || in[5] > b2_dynamicBody)
+        return false;
+    state->handle = getU32(in);
+    if (state->handle == INVALID_BODY_HANDLE)
+        return false;
+    state->kind = static_cast<BodyKind>(in[4]);
+    state->type = static_cast<b2BodyType>(in[5]);
+    state->awake = (in[6] & STATE_AWAKE) != 0;
+    state->enabled = (in[6] & STATE_ENABLED) != 0;
+    state->fixed_rotation = (in[6] & STATE_FIXED_ROTATION) != 0;
+    state->bullet = (in[6] & STATE_BULLET) != 0;
+    state->sleeping_allowed = (in[6] & STATE_SLEEPING_ALLOWED) != 0;
+    state->position = b2Vec2(getF32(in + 8), getF32(in + 12));
+    state->angle = getF32(in + 16);
+    state->linear_velocity = b2Vec2(getF32(in + 20), getF32(in + 24));
+    state->angular_velocity = getF32(in + 28);
+    state->dimensions = glm::vec2(getF32(in + 32), getF32(in + 36));
+    state->color = glm::vec3(getF32(in + 40), getF32(in + 44), getF32(in + 48));
+    state->density = getF32(in + 52);
+    state->friction = getF32(in + 56);
+    state->restitution = getF32(in + 60);
+    state->restitution_threshold = getF32(in + 64);
+    state->linear_damping = getF32(in + 68);
+    state->angular_damping = getF32(in + 72);
+    state->gravity_scale = getF32(in + 76);
+    return true;
+}
+
+bool isWorldStateFile(const std::string& filePath)
+{
+    std::ifstream infile(filePath, std::ios_base::in | std::ios_base::binary);
+    char magic[4];
+    return infile.read(magic, sizeof(magic)) && std::memcmp(magic, WORLD_STATE_MAGIC, sizeof(magic)) == 0;
+}
+
+bool saveWorldState(const std::string& filePath, const WorldState& state)
+{
+    const uint32_t body_count = static_cast<uint32_t>(state.bodies.size());
+    std::vector<unsigned char> buffer(WORLD_STATE_HEADER_SIZE + static_cast<size_t>(body_count) * WORLD_STATE_RECORD_SIZE, 0);
+    unsigned char* header = buffer.data();
+    std::memcpy(header, WORLD_STATE_MAGIC, sizeof(WORLD_STATE_MAGIC));
+    putU32(header + 4, WORLD_STATE_VERSION);
+    putU32(header + 8, body_count);
+    putU32(header + 12, WORLD_STATE_RECORD_SIZE);
+    putF32(header + 16, state.gravity.x);
+    putF32(header + 20, state.gravity.y);
+    putF32(header + 24, state.time_step);
+
+    for (uint32_t i = 0; i < body_count; i++)
+        encodeBodyState(state.bodies[i], buffer.data() + WORLD_STATE_HEADER_SIZE + static_cast<size_t>(i) * WORLD_STATE_RECORD_SIZE);
+
+    std::ofstream outfile(filePath, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+    if (!outfile.is_open())
+        return false;
+    outfile.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+    return static_cast<bool>(outfile);
+}
+
+bool loadWorldState(const std::string& filePath, WorldState* state)
+{
+    MappedFile file;
+    if (!file.open(filePath) || file.size() < WORLD_STATE_HEADER_SIZE)
+        return false;
+
+    const unsigned char* data = file.data();
+    if (std::memcmp(data, WORLD_STATE_MAGIC, sizeof(WORLD_STATE_MAGIC)) != 0 || getU32(data + 4) != WORLD_STATE_VERSION)
+        return false;
+    const uint32_t body_count = getU32(data + 8);
+    const uint32_t record_size = getU32(data + 12);
+    if (record_size < WORLD_STATE_RECORD_SIZE ||
+        WORLD_STATE_HEADER_SIZE + static_cast<uint64_t>(body_count) * record_size > file.size())
+        return false;
+
+    state->gravity = b2Vec2(getF32(data + 16), getF32(data + 20));
+    state->time_step = getF32(data + 24);
+    state->bodies.resize(body_count);
+    std::vector<BodyHandle> handles(body_count);
+    for (uint32_t i = 0; i < body_count; i++)
+    {
+        if (!decodeBodyState(data + WORLD_STATE_HEADER_SIZE + static_cast<size_t>(i) * record_size, &state->bodies[i]))
+            return false;
+        handles[i] = state->bodies[i].handle;
+    }
+    // every handle names one body, and the handles stay close enough together that the
+    // ones handed out after them don't wrap around
+    std::sort(handles.begin(), handles.end());
+    if (std::adjacent_find(handles.begin(), handles.end()) != handles.end())
+        return false;
+    if (!handles.empty() && (handles.back() - handles.front() >= WORLD_STATE_MAX_HANDLE_SPAN ||
+        handles.back() >= UINT32_MAX - WORLD_STATE_MAX_HANDLE_SPAN))
+        return false;
+    return true;
+}
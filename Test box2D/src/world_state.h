@@ -0,0 +1,65 @@
+#ifndef WORLD_STATE_H
+#define WORLD_STATE_H
+
+#include <box2d/box2d.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "body_store.h"
+
+// Everything needed to put a body back into a given state, or to create it again:
+// transform, velocities, sleep/enabled flags, body settings and fixture parameters.
+// The defaults are the ones of b2BodyDef and b2FixtureDef.
+struct BodyState {
+	BodyHandle handle = INVALID_BODY_HANDLE;
+	BodyKind kind = BodyKind::BOX;
+	b2BodyType type = b2_staticBody;
+	b2Vec2 position = b2Vec2_zero;
+	float angle = 0.0f;
+	b2Vec2 linear_velocity = b2Vec2_zero;
+	float angular_velocity = 0.0f;
+	bool awake = true;
+	bool enabled = true;
+	bool fixed_rotation = false;
+	bool bullet = false;
+	bool sleeping_allowed = true;
+	float linear_damping = 0.0f;
+	float angular_damping = 0.0f;
+	float gravity_scale = 1.0f;
+	glm::vec2 dimensions = glm::vec2(0.0f); // box width/height, or the circle diameter
+	glm::vec3 color = glm::vec3(1.0f);
+	float density = 0.0f;
+	float friction = 0.2f;
+	float restitution = 0.0f;
+	float restitution_threshold = 1.0f * b2_lengthUnitsPerMeter;
+};
+
+// state of a whole world, in BodyStore order
+struct WorldState {
+	std::vector<BodyState> bodies;
+	b2Vec2 gravity = b2Vec2(0.0f, 10.0f);
+	float time_step = 1.0f / 60.0f;
+
+	// records the state of a body and of its (single) fixture
+	static BodyState captureBody(BodyHandle handle, BodyKind kind, const glm::vec2& dimensions, const glm::vec3& color, const b2Body* body);
+};
+
+// World state files: a 32 byte header (magic "E2DW", version, body count, record
+// size, gravity, time step) followed by one fixed-size little-endian record per body.
+const char WORLD_STATE_MAGIC[4] = { 'E', '2', 'D', 'W' };
+const uint32_t WORLD_STATE_VERSION = 1;
+const uint32_t WORLD_STATE_HEADER_SIZE = 32;
+const uint32_t WORLD_STATE_RECORD_SIZE = 80;
+// a file is rejected if its handles are further apart than this
+const uint32_t WORLD_STATE_MAX_HANDLE_SPAN = 1u << 24;
+
+// returns true if the file starts with the world state magic
+bool isWorldStateFile(const std::string& filePath);
+// returns false if the file can't be written
+bool saveWorldState(const std::string& filePath, const WorldState& state);
+// returns false if the file is missing or malformed: an unknown body kind or type, an
+// invalid or repeated handle, or handles spread over more than WORLD_STATE_MAX_HANDLE_SPAN
+bool loadWorldState(const std::string& filePath, WorldState* state);
+
+#endif